@@ -8,6 +8,55 @@ constexpr juce::uint32 dark = 0xFF0A0E12;
 constexpr float kMinDb = -60.0f;
 constexpr float kMinGrDb = -48.0f;
 constexpr float kMaxDb = 0.0f;
+constexpr double kScopeSeconds = 2.0;
+}
+
+void TriBaseAudioProcessorEditor::Scope::setPointsPerSecond (double pointsPerSecond)
+{
+    if (pointsPerSecond == pointRate)
+        return;
+
+    pointRate = pointsPerSecond;
+    resized();
+}
+
+void TriBaseAudioProcessorEditor::Scope::resized()
+{
+    const int width = juce::jmax (getWidth(), 64);
+    pointsPerColumn = juce::jmax (1, juce::roundToInt (pointRate * kScopeSeconds / width));
+    trim();
+}
+
+void TriBaseAudioProcessorEditor::Scope::add (const GainTelemetry::Point* points, int numPoints)
+{
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const auto& point = points[i];
+
+        if (pendingPoints == 0)
+        {
+            pending = point;
+        }
+        else
+        {
+            pending.scMinDb = juce::jmin (pending.scMinDb, point.scMinDb);
+            pending.scMaxDb = juce::jmax (pending.scMaxDb, point.scMaxDb);
+            pending.grMinDb = juce::jmin (pending.grMinDb, point.grMinDb);
+            pending.grMaxDb = juce::jmax (pending.grMaxDb, point.grMaxDb);
+        }
+
+        if (++pendingPoints >= pointsPerColumn)
+        {
+            columns.add (pending);
+            pendingPoints = 0;
+        }
+    }
+
+    if (numPoints > 0)
+    {
+        trim();
+        repaint();
+    }
 }
 
 void TriBaseAudioProcessorEditor::Scope::paint (juce::Graphics& g)
@@ -29,32 +78,54 @@ void TriBaseAudioProcessorEditor::Scope::paint (juce::Graphics& g)
     drawGridLine (-6.0f, juce::Colours::grey);
     drawGridLine (0.0f, juce::Colours::white);
 
-    const auto drawTrace = [&] (const juce::Array<float>& values, juce::Colour colour, float minDb, float maxDb)
+    // Each trace is the band between a column's lowest and highest value, outlined along
+    // the edge that matters: the sidechain's peaks and the deepest reduction.
+    const auto drawTrace = [&] (float GainTelemetry::Point::* low, float GainTelemetry::Point::* high,
+                                bool outlineHigh, juce::Colour colour, float minDb, float maxDb)
     {
-        if (values.isEmpty())
+        const int size = columns.size();
+
+        if (size == 0)
             return;
 
-        juce::Path path;
-        const int size = values.size();
         const float step = bounds.getWidth() / juce::jmax (1, size - 1);
+        const auto xOf = [&] (int i) { return bounds.getX() + step * static_cast<float> (i); };
+        const auto yOf = [&] (float db) { return juce::jmap (juce::jlimit (minDb, maxDb, db), minDb, maxDb, bounds.getBottom(), bounds.getY()); };
+
+        juce::Path band, edge;
 
         for (int i = 0; i < size; ++i)
         {
-            const float x = bounds.getX() + step * static_cast<float> (i);
-            const float y = juce::jmap (values.getUnchecked (i), minDb, maxDb, bounds.getBottom(), bounds.getY());
+            const auto& column = columns.getReference (i);
+            const float y = yOf (column.*high);
+            const float edgeY = outlineHigh ? y : yOf (column.*low);
 
             if (i == 0)
-                path.startNewSubPath (x, y);
+            {
+                band.startNewSubPath (xOf (i), y);
+                edge.startNewSubPath (xOf (i), edgeY);
+            }
             else
-                path.lineTo (x, y);
+            {
+                band.lineTo (xOf (i), y);
+                edge.lineTo (xOf (i), edgeY);
+            }
         }
 
+        for (int i = size; --i >= 0;)
+            band.lineTo (xOf (i), yOf (columns.getReference (i).*low));
+
+        band.closeSubPath();
+
+        g.setColour (colour.withAlpha (0.35f));
+        g.fillPath (band);
         g.setColour (colour.withAlpha (0.9f));
-        g.strokePath (path, juce::PathStrokeType (1.5f));
+        g.strokePath (edge, juce::PathStrokeType (1.5f));
     };
 
-    drawTrace (scHistory, scColour, kMinDb, kMaxDb);
-    drawTrace (grHistory, grColour, kMinGrDb, 0.0f);
+    using Point = GainTelemetry::Point;
+    drawTrace (&Point::scMinDb, &Point::scMaxDb, true, scColour, kMinDb, kMaxDb);
+    drawTrace (&Point::grMinDb, &Point::grMaxDb, false, grColour, kMinGrDb, 0.0f);
 }
 
 TriBaseAudioProcessorEditor::TriBaseAudioProcessorEditor (TriBaseAudioProcessor& proc)
@@ -114,6 +185,8 @@ TriBaseAudioProcessorEditor::TriBaseAudioProcessorEditor (TriBaseAudioProcessor&
     mixAttachment = std::make_unique<SliderAttachment> (apvts, "mix", mixSlider);
     makeupAttachment = std::make_unique<SliderAttachment> (apvts, "makeupDb", makeupSlider);
 
+    // Whatever piled up while the editor was closed is stale.
+    processor.telemetry.discard();
     startTimerHz (60);
 }
 
@@ -171,9 +244,13 @@ void TriBaseAudioProcessorEditor::resized()
 
 void TriBaseAudioProcessorEditor::timerCallback()
 {
-    const auto sc = processor.meterScDb.load();
-    const auto gr = processor.meterGrDb.load();
-    lastGrDb = gr;
-    scope.push (sc, gr);
+    lastGrDb = processor.meterGrDb.load();
+
+    std::array<GainTelemetry::Point, 256> points;
+    scope.setPointsPerSecond (processor.sampleRateHz / GainTelemetry::pointSpacing);
+
+    while (const int n = processor.telemetry.pull (points.data(), static_cast<int> (points.size())))
+        scope.add (points.data(), n);
+
     repaint (meterBounds);
 }
@@ -14,15 +14,12 @@ public:
     public:
         void setColours (juce::Colour sc, juce::Colour gr) { scColour = sc; grColour = gr; }
 
-        void push (float scDb, float grDb)
-        {
-            scHistory.add (juce::jlimit (-60.0f, 0.0f, scDb));
-            grHistory.add (juce::jlimit (-48.0f, 0.0f, grDb));
-            trim();
-            repaint();
-        }
+        // Telemetry points are folded into one column of the trace per pointsPerColumn,
+        // keeping each column's extremes.
+        void setPointsPerSecond (double pointsPerSecond);
+        void add (const GainTelemetry::Point* points, int numPoints);
 
-        void resized() override { trim(); }
+        void resized() override;
 
         void paint (juce::Graphics& g) override;
 
@@ -30,11 +27,16 @@ public:
         void trim()
         {
             const int maxPts = juce::jmax (getWidth(), 64);
-            while (scHistory.size() > maxPts) scHistory.remove (0);
-            while (grHistory.size() > maxPts) grHistory.remove (0);
+
+            if (columns.size() > maxPts)
+                columns.removeRange (0, columns.size() - maxPts);
         }
 
-        juce::Array<float> scHistory, grHistory;
+        juce::Array<GainTelemetry::Point> columns;
+        GainTelemetry::Point pending {};
+        int pendingPoints { 0 };
+        int pointsPerColumn { 1 };
+        double pointRate { 0.0 };
         juce::Colour scColour, grColour;
     };
 
@@ -3,9 +3,20 @@
 
 #include <algorithm>
 #include <cmath>
-#include <array>
+#include <limits>
 #include <vector>
 
+namespace
+{
+int lookaheadToSamples (double sampleRate, float ms)
+{
+    return sampleRate > 0.0 ? static_cast<int> (std::lround (sampleRate * (ms / 1000.0f))) : 0;
+}
+
+// -3 dB, the ITU-R BS.775 fold-down weight for surround channels.
+constexpr float kSurroundWeight = 0.70710678f;
+}
+
 bool TriBaseAudioProcessor::supportsDoublePrecisionProcessing() const
 {
     return true;
@@ -16,63 +27,108 @@ bool TriBaseAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     const auto mainIn = layouts.getChannelSet (true, 0);
     const auto mainOut = layouts.getChannelSet (false, 0);
 
-    const auto isMonoOrStereo = [] (const juce::AudioChannelSet& set)
+    const auto isSupportedMain = [] (const juce::AudioChannelSet& set)
     {
-        return set == juce::AudioChannelSet::mono() || set == juce::AudioChannelSet::stereo();
+        return set == juce::AudioChannelSet::mono()
+            || set == juce::AudioChannelSet::stereo()
+            || set == juce::AudioChannelSet::create5point1()
+            || set == juce::AudioChannelSet::create7point1()
+            || set == juce::AudioChannelSet::create7point1point4();
     };
 
-    if (! isMonoOrStereo (mainIn) || ! isMonoOrStereo (mainOut))
-        return false;
-
-    if (mainIn.size() != mainOut.size())
+    if (! isSupportedMain (mainIn) || mainIn != mainOut)
         return false;
 
-    if (layouts.inputBuses.size() > 1)
-    {
-        const auto sidechain = layouts.getChannelSet (true, 1);
-        if (sidechain != juce::AudioChannelSet::stereo() && sidechain != juce::AudioChannelSet::disabled())
-            return false;
-    }
-
+    // Any sidechain layout is fine, from mono up to surround and immersive beds; the
+    // detector downmixes however many channels it carries.
     return true;
 }
 
 void TriBaseAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     sampleRateHz = sampleRate;
-    maxBlock = samplesPerBlock;
+    maxBlock = juce::jmax (1, samplesPerBlock);
 
-    detector.prepare (sampleRate, samplesPerBlock);
+    const auto look = raw.lookaheadMs->load();
+    const bool multirate = raw.scMultirate->load() >= 0.5f;
 
-    const int totalOutputs = getTotalNumOutputChannels();
-    delayLanes.resize (totalOutputs);
+    prevLookaheadMs = look;
+    prevMultirate = multirate;
+    prevFixedLatency = raw.fixedLatency->load() >= 0.5f;
+    triggerSource = getTriggerSource();
+    spectralDucking = isSpectralDucking();
+
+    // Weighted from the sidechain bus layout; prepareToPlay runs again whenever it changes.
+    const auto scLayout = getChannelLayoutOfBus (true, 1);
+    std::vector<float> scWeights (static_cast<size_t> (scLayout.size()));
+
+    for (int ch = 0; ch < scLayout.size(); ++ch)
+        scWeights[static_cast<size_t> (ch)] = getSidechainWeight (scLayout.getTypeOfChannel (ch));
 
-    const int maxDelay = juce::jmax (1, juce::roundToInt (sampleRate * 0.25));
-    for (auto& delay : delayLanes)
+    const auto prepareDetector = [&] (auto& detector)
     {
-        delay.setMaximumDelayInSamples (maxDelay);
-        delay.reset();
-    }
+        detector.setChannelWeights (scWeights.data(), static_cast<int> (scWeights.size()));
+        detector.setMultirate (multirate);
+        // It is only ever handed a detector span at a time, whatever the host's block.
+        detector.prepare (sampleRate, detectorSpan);
+        detector.setLookaheadMs (look);
+    };
 
-    const auto look = apvts.getRawParameterValue ("lookaheadMs")->load();
-    const auto ftype = static_cast<int> (apvts.getRawParameterValue ("scFilterType")->load());
-    const auto flo = apvts.getRawParameterValue ("scFilterLoHz")->load();
-    const auto fhi = apvts.getRawParameterValue ("scFilterHiHz")->load();
-    const auto rms = static_cast<int> (apvts.getRawParameterValue ("detectorMode")->load()) == 0;
+    prepareDetector (floatPath.detector);
+    prepareDetector (doublePath.detector);
 
-    detector.setModeRMS (rms);
-    detector.setFilter (ftype, flo, fhi);
-    detector.setLookaheadMs (look);
+    floatPath.sidechains.prepare (sampleRate, maxBlock);
+    doublePath.sidechains.prepare (sampleRate, maxBlock);
 
-    prevLookaheadMs = look;
+    const int totalOutputs = getTotalNumOutputChannels();
+
+    floatPath.spectral.prepare (sampleRate, totalOutputs, maxBlock);
+    doublePath.spectral.prepare (sampleRate, totalOutputs, maxBlock);
+
+    // Room for the longest lookahead plus the multirate detector's lag, or the spectral
+    // duck's latency, whichever is longer.
+    const int maxDelay = juce::jmax (lookaheadToSamples (sampleRate, LookaheadDetector<float>::maxLookaheadMs)
+                                         + floatPath.detector.getMaxLatencySamples(),
+                                     floatPath.spectral.getLatencySamples());
+
+    floatPath.delay.prepare (totalOutputs, maxDelay);
+    doublePath.delay.prepare (totalOutputs, maxDelay);
+    hitTemplate.prepare (sampleRate, maxDelay);
+
+    updateLatency (look);
+
+    floatPath.delay.reset();
+    doublePath.delay.reset();
+
+    // Not running yet, so the host can take the new figure straight away.
+    reportedLatency = latencySamples.load();
+    setLatencySamples (reportedLatency);
+
+    floatPath.crossover.prepare (sampleRate, totalOutputs);
+    doublePath.crossover.prepare (sampleRate, totalOutputs);
+    floatPath.unduckedPhase.prepare (sampleRate, totalOutputs);
+    doublePath.unduckedPhase.prepare (sampleRate, totalOutputs);
+
+    floatPath.gains.assign (static_cast<size_t> (maxBlock), 1.0f);
+    doublePath.gains.assign (static_cast<size_t> (maxBlock), 1.0);
+    floatPath.mainDownmix.assign (static_cast<size_t> (maxBlock), 0.0f);
+    doublePath.mainDownmix.assign (static_cast<size_t> (maxBlock), 0.0);
+
+    const auto mainLayout = getChannelLayoutOfBus (false, 0);
+    channelGroups.resize (static_cast<size_t> (mainLayout.size()));
 
-    const double sr = sampleRate;
-    latencySamples = sr > 0.0 ? static_cast<int> (std::lround (sr * (look / 1000.0f))) : 0;
-    setLatencySamples (latencySamples);
+    for (int ch = 0; ch < mainLayout.size(); ++ch)
+        channelGroups[static_cast<size_t> (ch)] = getChannelGroup (mainLayout.getTypeOfChannel (ch));
 
-    for (auto& delay : delayLanes)
-        delay.setDelay (static_cast<float> (latencySamples));
+    duckedChannels.reserve (channelGroups.size());
+    unduckedChannels.reserve (channelGroups.size());
+    duckGroupMask = -1;
 
+    gainComputer.prepare (sampleRate);
+    midiDuck.prepare (sampleRate);
+    tempoCurve.prepare (sampleRate);
+
+    updateDetectorSettings();
     refreshParams();
 }
 
@@ -82,14 +138,70 @@ void TriBaseAudioProcessor::releaseResources()
 
 int TriBaseAudioProcessor::getLatencySamples() const
 {
-    return latencySamples;
+    return latencySamples.load();
+}
+
+void TriBaseAudioProcessor::timerCallback()
+{
+    // setLatencySamples() notifies listeners under a lock, so it is never called from
+    // processBlock; the audio thread only publishes the new figure.
+    const int target = latencySamples.load();
+
+    if (target != reportedLatency)
+    {
+        reportedLatency = target;
+        setLatencySamples (target);
+    }
 }
 
 void TriBaseAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBlockInternal (buffer, midiMessages);
+}
+
+void TriBaseAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBlockInternal (buffer, midiMessages);
+}
+
+template <typename FloatType>
+TriBaseAudioProcessor::LookaheadPath<FloatType>& TriBaseAudioProcessor::getLookaheadPath() noexcept
+{
+    if constexpr (std::is_same_v<FloatType, double>)
+        return doublePath;
+    else
+        return floatPath;
+}
+
+template <typename FloatType>
+void TriBaseAudioProcessor::processBlockInternal (juce::AudioBuffer<FloatType>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
     applyParamUpdatesIfChanged();
-    juce::ignoreUnused (midiMessages);
+
+    const int numSamples = buffer.getNumSamples();
+
+    if (numSamples <= maxBlock)
+    {
+        processSpan (buffer, midiMessages, 0);
+        return;
+    }
+
+    // Every buffer below is sized in prepareToPlay(). A host that sends a longer block
+    // than it announced gets it a prepared block at a time, rather than buffers grown on
+    // the audio thread.
+    for (int start = 0; start < numSamples; start += maxBlock)
+    {
+        juce::AudioBuffer<FloatType> span (buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                           start, juce::jmin (maxBlock, numSamples - start));
+        processSpan (span, midiMessages, start);
+    }
+}
+
+template <typename FloatType>
+void TriBaseAudioProcessor::processSpan (juce::AudioBuffer<FloatType>& buffer, const juce::MidiBuffer& midiMessages, int midiOffset)
+{
+    auto& path = getLookaheadPath<FloatType>();
 
     auto inMain = getBusBuffer (buffer, true, 0);
     auto outMain = getBusBuffer (buffer, false, 0);
@@ -99,195 +211,241 @@ void TriBaseAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce
     for (int ch = getMainBusNumOutputChannels(); ch < outMain.getNumChannels(); ++ch)
         outMain.clear (ch, 0, outMain.getNumSamples());
 
-    if (delayLanes.size() != static_cast<size_t> (outMain.getNumChannels()))
-    {
-        const int maxDelay = juce::jmax (1, juce::roundToInt (getSampleRate() * 0.25));
-        delayLanes.resize (outMain.getNumChannels());
-        for (auto& delay : delayLanes)
-        {
-            delay.setMaximumDelayInSamples (maxDelay);
-            delay.reset();
-            delay.setDelay (static_cast<float> (latencySamples));
-        }
-    }
-
-    float blockPeakDb = -60.0f;
-
-    if (hasSidechainEnabled())
-    {
-        auto sc = getBusBuffer (buffer, true, 1);
-        const int numSamples = sc.getNumSamples();
-        const int nCh = juce::jmin (sc.getNumChannels(), 8);
-
-        std::array<const float*, 8> scPtrs { { nullptr } };
+    const int numSamples = outMain.getNumSamples();
+    const bool hasSidechain = hasSidechainEnabled();
+    const auto sc = getBusBuffer (buffer, true, hasSidechain ? 1 : 0);
 
-        for (int c = 0; c < nCh; ++c)
-            scPtrs[c] = sc.getReadPointer (c);
+    // In MIDI and tempo modes the detector is skipped entirely, and the spectral duck reads
+    // the sidechain itself.
+    const bool useDetector = (triggerSource == TriggerSource::sidechain && ! spectralDucking)
+                          || triggerSource == TriggerSource::predictive;
 
-        const auto* env = detector.processSidechain (scPtrs.data(), nCh, numSamples);
+    // The detector runs inside the gain loop below: either on the first sidechain bus, or
+    // on the bank's merged level when extra inputs are in use.
+    const FloatType* detection = nullptr;
+    const FloatType* const* scChannels = nullptr;
 
-        float guiPeak = 0.0f;
-        for (int i = 0; i < numSamples; ++i)
+    if (useDetector && hasExtraSidechainEnabled())
+    {
+        // Every input is filtered and levelled in its own lane; the envelope runs once on
+        // the merged level.
+        for (int lane = 0; lane < numSidechainInputs; ++lane)
         {
-            const float linear = juce::jlimit (1.0e-6f, 1.0f, std::abs (env[i]));
-            guiPeak = std::max (guiPeak, linear);
-            blockPeakDb = std::max (blockPeakDb, juce::Decibels::gainToDecibels (linear, -60.0f));
+            auto* bus = getBus (true, lane + 1);
+
+            if (bus != nullptr && bus->isEnabled())
+            {
+                auto laneBus = getBusBuffer (buffer, true, lane + 1);
+
+                // The main input keeps its channel weights and link whether or not the
+                // extra inputs are on; the others are plain averages.
+                if (lane == 0)
+                {
+                    FloatType* const mono = path.mainDownmix.data();
+                    path.detector.downmix (laneBus.getArrayOfReadPointers(), laneBus.getNumChannels(), 0, mono, numSamples);
+                    path.sidechains.loadLane (0, &mono, 1, numSamples);
+                }
+                else
+                {
+                    path.sidechains.loadLane (lane, laneBus.getArrayOfReadPointers(), laneBus.getNumChannels(), numSamples);
+                }
+            }
+            else
+            {
+                path.sidechains.loadLane (lane, nullptr, 0, numSamples);
+            }
         }
 
-        scLevel.store (juce::jlimit (0.0f, 1.0f, guiPeak));
+        detection = path.sidechains.process (numSamples);
     }
-    else
+    else if (useDetector && hasSidechain)
     {
-        scLevel.store (0.0f);
+        scChannels = sc.getArrayOfReadPointers();
     }
 
-    if (! std::isfinite (blockPeakDb))
-        blockPeakDb = -60.0f;
+    const int numChannels = juce::jmin (outMain.getNumChannels(), path.delay.getNumChannels());
+    const auto wetMix = static_cast<FloatType> (juce::jlimit (0.0f, 1.0f, mix));
+    const auto dryMix = static_cast<FloatType> (1) - wetMix;
 
-    meterScDb.store (juce::jlimit (-60.0f, 0.0f, blockPeakDb));
+    FloatType* ducked[maxMainChannels];
+    FloatType* unducked[maxMainChannels];
+    int numDucked = 0;
+    int numUnducked = 0;
 
-    const float sr = static_cast<float> (getSampleRate());
-    const float attackCoeff = (sr > 0.0f) ? std::exp (-1.0f / (0.001f * atkMs * sr)) : 0.0f;
-    const float releaseCoeff = (sr > 0.0f) ? std::exp (-1.0f / (0.001f * relMs * sr)) : 0.0f;
+    for (const int ch : duckedChannels)
+        if (ch < numChannels && numDucked < maxMainChannels)
+            ducked[numDucked++] = outMain.getWritePointer (ch);
 
-    const int numSamples = outMain.getNumSamples();
-    const float wetMix = juce::jlimit (0.0f, 1.0f, mix);
-    const float dryMix = 1.0f - wetMix;
+    for (const int ch : unduckedChannels)
+        if (ch < numChannels && numUnducked < maxMainChannels)
+            unducked[numUnducked++] = outMain.getWritePointer (ch);
 
-    for (int n = 0; n < numSamples; ++n)
+    if (spectralDucking)
     {
-        const float targetDb = blockPeakDb;
+        // The spectral duck analyses the signal before the delay and hands back, two hops
+        // later, what to take out of the delayed one.
+        path.spectral.process (ducked, numDucked,
+                               hasSidechain ? sc.getArrayOfReadPointers() : nullptr,
+                               hasSidechain ? sc.getNumChannels() : 0,
+                               numSamples);
+    }
 
-        if (targetDb > envDb)
-            envDb = attackCoeff * envDb + (1.0f - attackCoeff) * targetDb;
-        else
-            envDb = releaseCoeff * envDb + (1.0f - releaseCoeff) * targetDb;
+    // Dry and wet both come from the delayed signal, so a parallel mix stays in phase.
+    path.delay.process (outMain.getArrayOfWritePointers(), numChannels, numSamples);
 
-        grDb = computeGainDb (envDb);
-        const float gain = juce::Decibels::decibelsToGain (grDb + makeupDb);
+    if (spectralDucking)
+    {
+        // wet * makeup * (x - residual) + dry * x, the same mix the gain curve gets.
+        const auto scale = static_cast<FloatType> (makeupGain) * wetMix + dryMix;
+        const auto removed = -static_cast<FloatType> (makeupGain) * wetMix;
 
-        for (int ch = 0; ch < outMain.getNumChannels(); ++ch)
+        for (int i = 0; i < numDucked; ++i)
         {
-            auto* data = outMain.getWritePointer (ch);
-            const float dry = data[n];
-            const float delayed = delayLanes[(size_t) ch].popSample (0);
-            delayLanes[(size_t) ch].pushSample (0, dry);
-            const float wet = delayed * gain;
-            data[n] = wet * wetMix + dry * dryMix;
+            if (scale != static_cast<FloatType> (1))
+                juce::FloatVectorOperations::multiply (ducked[i], scale, numSamples);
+
+            juce::FloatVectorOperations::addWithMultiply (ducked[i], path.spectral.getResidual (i), removed, numSamples);
         }
-    }
 
-    meterGrDb.store (juce::jlimit (-48.0f, 0.0f, grDb));
-}
+        const float grDb = juce::jlimit (-48.0f, 0.0f, path.spectral.getGainReductionDb());
+        const float grGain = juce::Decibels::decibelsToGain (grDb);
+        const float scPeak = hasSidechain ? static_cast<float> (sc.getMagnitude (0, numSamples)) : 0.0f;
 
-void TriBaseAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
-{
-    juce::ScopedNoDenormals noDenormals;
-    applyParamUpdatesIfChanged();
-    juce::ignoreUnused (midiMessages);
+        updateScMeter (scPeak);
 
-    auto inMain = getBusBuffer (buffer, true, 0);
-    auto outMain = getBusBuffer (buffer, false, 0);
+        // Only block-level figures exist here; the reduction changes once a hop anyway.
+        telemetry.push (scPeak, scPeak, grGain, grGain, numSamples);
+        meterGrDb.store (grDb);
+        return;
+    }
 
-    outMain.makeCopyOf (inMain, true);
+    // The curve is computed in float a tile at a time, then widened into one block of gains
+    // that every ducked channel shares.
+    alignas (32) float curve[GainComputer::tileSize];
 
-    for (int ch = getMainBusNumOutputChannels(); ch < outMain.getNumChannels(); ++ch)
-        outMain.clear (ch, 0, outMain.getNumSamples());
+    // processBlockInternal() never hands over more than the prepared block.
+    jassert (numSamples <= static_cast<int> (path.gains.size()));
 
-    if (delayLanes.size() != static_cast<size_t> (outMain.getNumChannels()))
-    {
-        const int maxDelay = juce::jmax (1, juce::roundToInt (getSampleRate() * 0.25));
-        delayLanes.resize (outMain.getNumChannels());
-        for (auto& delay : delayLanes)
-        {
-            delay.setMaximumDelayInSamples (maxDelay);
-            delay.reset();
-            delay.setDelay (static_cast<float> (latencySamples));
-        }
-    }
+    FloatType* const gains = path.gains.data();
+    bool unity = true;
 
-    float blockPeakDb = -60.0f;
+    auto nextEvent = midiMessages.findNextSamplePosition (midiOffset);
+    const auto midiEnd = midiMessages.findNextSamplePosition (midiOffset + numSamples);
 
-    if (hasSidechainEnabled())
-    {
-        auto sc = getBusBuffer (buffer, true, 1);
-        const int numSamples = sc.getNumSamples();
-        const int nCh = juce::jmin (sc.getNumChannels(), 8);
+    if (triggerSource == TriggerSource::tempo)
+        syncTempoCurve();
 
-        static thread_local std::array<std::vector<float>, 8> scTemp;
-        std::array<const float*, 8> scPtrs { { nullptr } };
+    // Every curve carries the makeup gain; the scope shows the reduction alone.
+    const float withoutMakeup = 1.0f / makeupGain;
 
-        for (int c = 0; c < nCh; ++c)
-        {
-            auto& tmp = scTemp[c];
-            tmp.resize (static_cast<size_t> (numSamples));
+    const FloatType* env = nullptr;
+    float scPeak = 0.0f;
 
-            const auto* src = sc.getReadPointer (c);
-            float* dst = tmp.data();
+    for (int start = 0; start < numSamples; start += GainComputer::tileSize)
+    {
+        const int n = juce::jmin (GainComputer::tileSize, numSamples - start);
+        bool flat = true;
 
-            for (int i = 0; i < numSamples; ++i)
-                dst[i] = static_cast<float> (src[i]);
+        // Downmix, filters and envelope run a span at a time just ahead of the gain tiles
+        // that read it, so the sidechain is streamed through cache once per block.
+        if (start % detectorSpan == 0 && (detection != nullptr || scChannels != nullptr))
+        {
+            const int span = juce::jmin (detectorSpan, numSamples - start);
 
-            scPtrs[c] = dst;
+            env = detection != nullptr ? path.detector.processDetection (detection + start, span)
+                                       : path.detector.processSidechain (scChannels, sc.getNumChannels(), start, span);
         }
 
-        const auto* env = detector.processSidechain (scPtrs.data(), nCh, numSamples);
+        const FloatType* tileEnv = env != nullptr ? env + start % detectorSpan : nullptr;
 
-        float guiPeak = 0.0f;
-        for (int i = 0; i < numSamples; ++i)
+        if (triggerSource == TriggerSource::tempo)
+        {
+            flat = tempoCurve.process (curve, n);
+        }
+        else if (triggerSource == TriggerSource::midi)
         {
-            const float linear = juce::jlimit (1.0e-6f, 1.0f, std::abs (env[i]));
-            guiPeak = std::max (guiPeak, linear);
-            blockPeakDb = std::max (blockPeakDb, juce::Decibels::gainToDecibels (linear, -60.0f));
+            // Render up to each note-on, then start its hit on exactly that sample.
+            for (int i = 0; i < n;)
+            {
+                for (; nextEvent != midiEnd && (*nextEvent).samplePosition - midiOffset <= start + i; ++nextEvent)
+                {
+                    const auto message = (*nextEvent).getMessage();
+
+                    if (message.isNoteOn())
+                        midiDuck.trigger (message.getFloatVelocity());
+                }
+
+                const int until = nextEvent != midiEnd ? juce::jmin (n, (*nextEvent).samplePosition - midiOffset - start) : n;
+                flat = midiDuck.process (curve + i, until - i) && flat;
+                i = until;
+            }
         }
+        else
+        {
+            flat = gainComputer.processTile (tileEnv, curve, n);
 
-        scLevel.store (juce::jlimit (0.0f, 1.0f, guiPeak));
-    }
-    else
-    {
-        scLevel.store (0.0f);
-    }
+            if (triggerSource == TriggerSource::predictive)
+                flat = hitTemplate.process (tileEnv, curve, n, flat);
+        }
 
-    if (! std::isfinite (blockPeakDb))
-        blockPeakDb = -60.0f;
+        const auto scRange = tileEnv != nullptr ? juce::FloatVectorOperations::findMinAndMax (tileEnv, n)
+                                                : juce::Range<FloatType>();
+        const auto gainRange = flat ? juce::Range<float> (curve[0], curve[0])
+                                    : juce::FloatVectorOperations::findMinAndMax (curve, n);
 
-    meterScDb.store (juce::jlimit (-60.0f, 0.0f, blockPeakDb));
+        telemetry.push (static_cast<float> (scRange.getStart()), static_cast<float> (scRange.getEnd()),
+                        gainRange.getStart() * withoutMakeup, gainRange.getEnd() * withoutMakeup, n);
+        scPeak = juce::jmax (scPeak, static_cast<float> (scRange.getEnd()));
 
-    const float sr = static_cast<float> (getSampleRate());
-    const float attackCoeff = (sr > 0.0f) ? std::exp (-1.0f / (0.001f * atkMs * sr)) : 0.0f;
-    const float releaseCoeff = (sr > 0.0f) ? std::exp (-1.0f / (0.001f * relMs * sr)) : 0.0f;
+        if (flat && curve[0] == 1.0f)
+        {
+            std::fill (gains + start, gains + start + n, static_cast<FloatType> (1));
+            continue;
+        }
 
-    const int numSamples = outMain.getNumSamples();
-    const float wetMix = juce::jlimit (0.0f, 1.0f, mix);
-    const float dryMix = 1.0f - wetMix;
+        for (int i = 0; i < n; ++i)
+            gains[start + i] = static_cast<FloatType> (curve[i]) * wetMix + dryMix;
 
-    for (int n = 0; n < numSamples; ++n)
-    {
-        const float targetDb = blockPeakDb;
+        unity = false;
+    }
 
-        if (targetDb > envDb)
-            envDb = attackCoeff * envDb + (1.0f - attackCoeff) * targetDb;
-        else
-            envDb = releaseCoeff * envDb + (1.0f - releaseCoeff) * targetDb;
+    updateScMeter (scPeak);
 
-        grDb = computeGainDb (envDb);
-        const float gain = juce::Decibels::decibelsToGain (grDb + makeupDb);
+    // The crossover's filters have to see every sample, so only broadband skips unity blocks.
+    // Its band sum is an allpass, so channels left unducked get the same allpass to keep
+    // every channel in phase.
+    if (splitBands)
+    {
+        path.crossover.process (ducked, numDucked, 0, gains, numSamples);
+        path.unduckedPhase.processAllpass (unducked, numUnducked, 0, numSamples);
+    }
+    else if (! unity)
+    {
+        for (int i = 0; i < numDucked; ++i)
+            juce::FloatVectorOperations::multiply (ducked[i], gains, numSamples);
+    }
 
-        for (int ch = 0; ch < outMain.getNumChannels(); ++ch)
+    const float grDb = [this]
+    {
+        switch (triggerSource)
         {
-            auto* data = outMain.getWritePointer (ch);
-            const double dryDouble = data[n];
-            const float dry = static_cast<float> (dryDouble);
-            const float delayed = delayLanes[(size_t) ch].popSample (0);
-            delayLanes[(size_t) ch].pushSample (0, dry);
-            const double wet = static_cast<double> (delayed * gain);
-            data[n] = wet * static_cast<double> (wetMix) + dryDouble * static_cast<double> (dryMix);
+            case TriggerSource::midi:       return midiDuck.getGainReductionDb();
+            case TriggerSource::predictive: return hitTemplate.getGainReductionDb();
+            case TriggerSource::tempo:      return tempoCurve.getGainReductionDb();
+            case TriggerSource::sidechain:  break;
         }
-    }
+
+        return gainComputer.getGainReductionDb();
+    }();
 
     meterGrDb.store (juce::jlimit (-48.0f, 0.0f, grDb));
 }
 
+template void TriBaseAudioProcessor::processBlockInternal (juce::AudioBuffer<float>&, juce::MidiBuffer&);
+template void TriBaseAudioProcessor::processBlockInternal (juce::AudioBuffer<double>&, juce::MidiBuffer&);
+template void TriBaseAudioProcessor::processSpan (juce::AudioBuffer<float>&, const juce::MidiBuffer&, int);
+template void TriBaseAudioProcessor::processSpan (juce::AudioBuffer<double>&, const juce::MidiBuffer&, int);
+
 void TriBaseAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
     if (auto state = apvts.copyState().createXml())
@@ -317,7 +475,9 @@ juce::AudioProcessorEditor* TriBaseAudioProcessor::createEditor()
 
 bool TriBaseAudioProcessor::acceptsMidi() const
 {
-    return false;
+    // The AU stays an aufx effect, which hosts never send MIDI to, so the MIDI
+    // trigger is only offered through VST3.
+    return wrapperType != wrapperType_AudioUnit;
 }
 
 bool TriBaseAudioProcessor::producesMidi() const
@@ -360,53 +520,401 @@ void TriBaseAudioProcessor::changeProgramName (int, const juce::String&)
 
 void TriBaseAudioProcessor::applyParamUpdatesIfChanged()
 {
-    const auto look = apvts.getRawParameterValue ("lookaheadMs")->load();
-
-    if (std::abs (look - prevLookaheadMs) > 1.0e-3f)
+    const auto look = raw.lookaheadMs->load();
+    const bool multirate = raw.scMultirate->load() >= 0.5f;
+    const bool fixed = raw.fixedLatency->load() >= 0.5f;
+    const auto source = getTriggerSource();
+    const bool spectral = isSpectralDucking();
+
+    if (std::abs (look - prevLookaheadMs) > 1.0e-3f || multirate != prevMultirate
+        || fixed != prevFixedLatency || source != triggerSource || spectral != spectralDucking)
     {
-        detector.setLookaheadMs (look);
+        // Frames left over from the last time the spectral duck ran mean nothing now.
+        if (spectral && ! spectralDucking)
+        {
+            floatPath.spectral.reset();
+            doublePath.spectral.reset();
+        }
+
         prevLookaheadMs = look;
+        prevMultirate = multirate;
+        prevFixedLatency = fixed;
+        triggerSource = source;
+        spectralDucking = spectral;
 
-        const double sr = getSampleRate();
-        latencySamples = sr > 0.0 ? static_cast<int> (std::lround (sr * (look / 1000.0f))) : 0;
-        setLatencySamples (latencySamples);
+        floatPath.detector.setLookaheadMs (look);
+        floatPath.detector.setMultirate (multirate);
+        doublePath.detector.setLookaheadMs (look);
+        doublePath.detector.setMultirate (multirate);
 
-        for (auto& delay : delayLanes)
-            delay.setDelay (static_cast<float> (latencySamples));
+        updateLatency (look);
     }
 
-    const auto ftype = static_cast<int> (apvts.getRawParameterValue ("scFilterType")->load());
-    const auto flo = apvts.getRawParameterValue ("scFilterLoHz")->load();
-    const auto fhi = apvts.getRawParameterValue ("scFilterHiHz")->load();
-    const auto rms = static_cast<int> (apvts.getRawParameterValue ("detectorMode")->load()) == 0;
+    updateDetectorSettings();
+    refreshParams();
+}
 
-    detector.setModeRMS (rms);
-    detector.setFilter (ftype, flo, fhi);
+int TriBaseAudioProcessor::computeLatencySamples (float lookaheadMs) const
+{
+    // The spectral duck's output is two hops behind its input.
+    if (spectralDucking)
+        return floatPath.spectral.getLatencySamples();
+
+    // Only the plain sidechain mode needs the audio delayed: MIDI hits and the tempo grid
+    // are known on time, and predictive mode plays its learned template from the onset.
+    // The audio waits out the lookahead and whatever lag the detector adds, so the
+    // envelope still leads it by exactly the lookahead.
+    if (triggerSource != TriggerSource::sidechain)
+        return 0;
+
+    // With fixed latency the audio always waits out the longest lookahead and the
+    // detector's worst-case lag, so automation never changes what the host compensates.
+    if (prevFixedLatency)
+        return lookaheadToSamples (sampleRateHz, LookaheadDetector<float>::maxLookaheadMs)
+             + floatPath.detector.getMaxLatencySamples();
+
+    return lookaheadToSamples (sampleRateHz, lookaheadMs) + floatPath.detector.getLatencySamples();
+}
 
-    refreshParams();
+void TriBaseAudioProcessor::updateLatency (float lookaheadMs)
+{
+    const int latency = computeLatencySamples (lookaheadMs);
+    const int lead = lookaheadToSamples (sampleRateHz, lookaheadMs) + floatPath.detector.getLatencySamples();
+
+    // The template is read as far ahead of the onset as a delayed path would have been.
+    hitTemplate.setAdvance (lead);
+
+    // Whatever the audio delay holds beyond the lookahead and the detector's own lag is
+    // made up on the envelope side, which keeps the effective lookahead where it was set.
+    const bool envelopeLeads = triggerSource == TriggerSource::sidechain && ! spectralDucking;
+    const int envelopeDelay = envelopeLeads ? juce::jmax (0, latency - lead) : 0;
+
+    floatPath.detector.setEnvelopeDelay (envelopeDelay);
+    doublePath.detector.setEnvelopeDelay (envelopeDelay);
+
+    if (latency != floatPath.delay.getDelay())
+    {
+        floatPath.delay.setDelay (latency);
+        doublePath.delay.setDelay (latency);
+    }
+
+    latencySamples.store (latency);
 }
 
-void TriBaseAudioProcessor::refreshParams()
+void TriBaseAudioProcessor::updateDetectorSettings()
+{
+    const auto mode = getDetectorMode();
+    const auto rmsWindow = raw.rmsWindowMs->load();
+    const auto ftype = static_cast<int> (raw.scFilterType->load());
+    const auto flo = raw.scFilterLoHz->load();
+    const auto fhi = raw.scFilterHiHz->load();
+    const auto link = static_cast<int> (raw.scLink->load()) == 1 ? SidechainLink::max : SidechainLink::sum;
+
+    const auto combine = static_cast<int> (raw.scCombine->load()) == 1 ? SidechainCombine::sum : SidechainCombine::max;
+
+    // Each extra input's level is rescaled so that it meets the main threshold at its own
+    // threshold, and held below the level that would give more than its own depth.
+    const auto mainThreshold = juce::Decibels::decibelsToGain (raw.threshold->load());
+    const auto slope = 1.0f - 1.0f / juce::jmax (1.0f, raw.ratio->load());
+
+    const auto configure = [&] (auto& path)
+    {
+        path.detector.setMode (mode);
+        path.detector.setRmsWindowMs (rmsWindow);
+        path.detector.setFilter (ftype, flo, fhi);
+        path.detector.setLink (link);
+
+        path.sidechains.setCombine (combine);
+        path.sidechains.setLane (0, ftype, flo, fhi, 1.0f, std::numeric_limits<float>::max());
+
+        for (size_t i = 0; i < raw.extraSc.size(); ++i)
+        {
+            const auto& sc = raw.extraSc[i];
+            const auto threshold = sc.threshold->load();
+            const auto ceilingDb = slope > 0.0f ? sc.depthDb->load() / slope : 0.0f;
+
+            path.sidechains.setLane (static_cast<int> (i) + 1,
+                                     static_cast<int> (sc.filterType->load()),
+                                     sc.filterLoHz->load(),
+                                     sc.filterHiHz->load(),
+                                     mainThreshold / juce::Decibels::decibelsToGain (threshold),
+                                     mainThreshold * juce::Decibels::decibelsToGain (ceilingDb));
+        }
+    };
+
+    configure (floatPath);
+    configure (doublePath);
+}
+
+DetectorMode TriBaseAudioProcessor::getDetectorMode() const
+{
+    // Choices 0 and 1 are the original "RMS" and "Peak", which both ran |x| through the
+    // lookahead smoother; they keep doing so for existing sessions.
+    switch (static_cast<int> (raw.detectorMode->load()))
+    {
+        case 2:  return DetectorMode::slidingRms;
+        case 3:  return DetectorMode::peakHold;
+        default: return DetectorMode::smoothed;
+    }
+}
+
+TriBaseAudioProcessor::TriggerSource TriBaseAudioProcessor::getTriggerSource() const
+{
+    switch (static_cast<int> (raw.triggerSource->load()))
+    {
+        case 1:  return acceptsMidi() ? TriggerSource::midi : TriggerSource::sidechain;
+        case 2:  return TriggerSource::predictive;
+        case 3:  return TriggerSource::tempo;
+        default: return TriggerSource::sidechain;
+    }
+}
+
+void TriBaseAudioProcessor::updateScMeter (float peak) noexcept
+{
+    const float level = std::isfinite (peak) ? juce::jlimit (0.0f, 1.0f, peak) : 0.0f;
+
+    scLevel.store (level);
+    meterScDb.store (juce::jlimit (-60.0f, 0.0f, juce::Decibels::gainToDecibels (level, -60.0f)));
+}
+
+bool TriBaseAudioProcessor::isSpectralDucking() const
+{
+    // Spectral needs the sidechain's own spectrum; with any other trigger it reads as
+    // broadband.
+    return static_cast<int> (raw.duckMode->load()) == 2 && getTriggerSource() == TriggerSource::sidechain;
+}
+
+int TriBaseAudioProcessor::getChannelGroup (juce::AudioChannelSet::ChannelType type)
+{
+    using Set = juce::AudioChannelSet;
+
+    switch (type)
+    {
+        case Set::left:
+        case Set::right:
+        case Set::centre:
+        case Set::leftCentre:
+        case Set::rightCentre:
+        case Set::wideLeft:
+        case Set::wideRight:
+            return frontGroup;
+
+        case Set::LFE:
+        case Set::LFE2:
+            return lfeGroup;
+
+        case Set::topMiddle:
+        case Set::topFrontLeft:
+        case Set::topFrontCentre:
+        case Set::topFrontRight:
+        case Set::topRearLeft:
+        case Set::topRearCentre:
+        case Set::topRearRight:
+        case Set::topSideLeft:
+        case Set::topSideRight:
+            return heightGroup;
+
+        default:
+            return surroundGroup;
+    }
+}
+
+float TriBaseAudioProcessor::getSidechainWeight (juce::AudioChannelSet::ChannelType type)
 {
-    threshDb = apvts.getRawParameterValue ("threshold")->load();
-    ratio    = apvts.getRawParameterValue ("ratio")->load();
-    atkMs    = apvts.getRawParameterValue ("attackMs")->load();
-    relMs    = apvts.getRawParameterValue ("releaseMs")->load();
-    depthDb  = apvts.getRawParameterValue ("depthDb")->load();
-    mix      = apvts.getRawParameterValue ("mix")->load() * 0.01f;
-    makeupDb = apvts.getRawParameterValue ("makeupDb")->load();
+    using Set = juce::AudioChannelSet;
 
-    mix = juce::jlimit (0.0f, 1.0f, mix);
+    // A surround drum bed is detected as it would sound folded down to stereo: surrounds
+    // and heights at -3 dB. Fronts, LFE and discrete channels count in full, so mono,
+    // stereo and discrete sidechains are detected as before.
+    switch (type)
+    {
+        case Set::leftSurround:
+        case Set::rightSurround:
+        case Set::centreSurround:
+        case Set::leftSurroundSide:
+        case Set::rightSurroundSide:
+        case Set::leftSurroundRear:
+        case Set::rightSurroundRear:
+            return kSurroundWeight;
+
+        default:
+            return getChannelGroup (type) == heightGroup ? kSurroundWeight : 1.0f;
+    }
 }
 
-float TriBaseAudioProcessor::computeGainDb (float detectorDb)
+void TriBaseAudioProcessor::updateDuckedChannels (int groupMask)
 {
-    const float over = detectorDb - threshDb;
-    if (over <= 0.0f)
-        return 0.0f;
+    if (groupMask == duckGroupMask)
+        return;
+
+    duckGroupMask = groupMask;
+
+    // The crossovers and the spectral duck keep state by position in their lists, which
+    // are about to move, so note where each channel was and what its crossover held.
+    jassert (channelGroups.size() <= static_cast<size_t> (maxMainChannels));
+
+    int previousSlot[maxMainChannels];
+    bool wasDucked[maxMainChannels] {};
+    Crossover<float>::ChannelState floatStates[maxMainChannels];
+    Crossover<double>::ChannelState doubleStates[maxMainChannels];
+
+    std::fill (std::begin (previousSlot), std::end (previousSlot), -1);
+
+    const auto note = [&] (const std::vector<int>& list, bool ducked, auto& floatSource, auto& doubleSource)
+    {
+        for (size_t slot = 0; slot < list.size(); ++slot)
+        {
+            const int ch = list[slot];
+
+            if (ch < 0 || ch >= maxMainChannels)
+                continue;
+
+            previousSlot[ch] = static_cast<int> (slot);
+            wasDucked[ch] = ducked;
+            floatStates[ch] = floatSource.getChannelState (static_cast<int> (slot));
+            doubleStates[ch] = doubleSource.getChannelState (static_cast<int> (slot));
+        }
+    };
+
+    note (duckedChannels, true, floatPath.crossover, doublePath.crossover);
+    note (unduckedChannels, false, floatPath.unduckedPhase, doublePath.unduckedPhase);
+
+    // Reserved in prepareToPlay, so rebuilding the lists never allocates.
+    duckedChannels.clear();
+    unduckedChannels.clear();
+
+    for (size_t ch = 0; ch < channelGroups.size(); ++ch)
+    {
+        if ((channelGroups[ch] & groupMask) != 0)
+            duckedChannels.push_back (static_cast<int> (ch));
+        else
+            unduckedChannels.push_back (static_cast<int> (ch));
+    }
+
+    // Only the channels that changed lists lose anything. Both crossovers run the same
+    // allpass, so a channel crossing over keeps that state and starts its low band from
+    // silence; the spectral duck starts its history afresh.
+    int spectralPrevious[maxMainChannels];
+    std::fill (std::begin (spectralPrevious), std::end (spectralPrevious), -1);
+
+    const auto restore = [&] (const std::vector<int>& list, bool ducked, auto& floatDest, auto& doubleDest)
+    {
+        for (size_t slot = 0; slot < list.size(); ++slot)
+        {
+            const int ch = list[slot];
+
+            if (ch < 0 || ch >= maxMainChannels)
+                continue;
+
+            auto floatState = floatStates[ch];
+            auto doubleState = doubleStates[ch];
+
+            if (wasDucked[ch] != ducked)
+            {
+                floatState = { {}, {}, { floatState.ap[0], floatState.ap[1] } };
+                doubleState = { {}, {}, { doubleState.ap[0], doubleState.ap[1] } };
+            }
+
+            floatDest.setChannelState (static_cast<int> (slot), floatState);
+            doubleDest.setChannelState (static_cast<int> (slot), doubleState);
+
+            if (ducked)
+                spectralPrevious[slot] = wasDucked[ch] ? previousSlot[ch] : -1;
+        }
+    };
+
+    restore (duckedChannels, true, floatPath.crossover, doublePath.crossover);
+    restore (unduckedChannels, false, floatPath.unduckedPhase, doublePath.unduckedPhase);
+
+    const int numDucked = juce::jmin (static_cast<int> (duckedChannels.size()), maxMainChannels);
+    floatPath.spectral.remapChannels (spectralPrevious, numDucked);
+    doublePath.spectral.remapChannels (spectralPrevious, numDucked);
+}
+
+void TriBaseAudioProcessor::syncTempoCurve()
+{
+    auto* playHead = getPlayHead();
+
+    if (playHead == nullptr)
+        return;
+
+    const auto position = playHead->getPosition();
+
+    if (! position.hasValue())
+        return;
+
+    if (const auto bpm = position->getBpm())
+        tempoCurve.setTempo (*bpm);
+
+    // While stopped the curve keeps running at the last tempo, so it can still be auditioned.
+    if (position->getIsPlaying())
+        if (const auto ppq = position->getPpqPosition())
+            tempoCurve.setPpqPosition (*ppq);
+}
+
+void TriBaseAudioProcessor::refreshParams()
+{
+    gainComputer.setParameters (raw.threshold->load(),
+                                raw.ratio->load(),
+                                raw.kneeDb->load(),
+                                raw.depthDb->load(),
+                                raw.makeupDb->load(),
+                                raw.attackMs->load(),
+                                raw.releaseMs->load());
+
+    midiDuck.setParameters (raw.depthDb->load(),
+                            raw.makeupDb->load(),
+                            raw.attackMs->load(),
+                            raw.releaseMs->load());
+
+    hitTemplate.setParameters (raw.threshold->load(), raw.makeupDb->load());
+
+    const auto setSpectral = [this] (auto& spectral)
+    {
+        spectral.setParameters (raw.threshold->load(),
+                                raw.ratio->load(),
+                                raw.depthDb->load(),
+                                raw.attackMs->load(),
+                                raw.releaseMs->load());
+    };
+
+    setSpectral (floatPath.spectral);
+    setSpectral (doublePath.spectral);
+
+    // Sync choices run from a whole bar down to a sixteenth, in quarter notes.
+    const auto syncIndex = juce::jlimit (0, 4, static_cast<int> (raw.syncRate->load()));
+    tempoCurve.setParameters (raw.depthDb->load(),
+                              raw.makeupDb->load(),
+                              4.0 / static_cast<double> (1 << syncIndex),
+                              raw.pumpRecovery->load() * 0.01f,
+                              raw.pumpCurve->load());
+
+    mix = juce::jlimit (0.0f, 1.0f, raw.mix->load() * 0.01f);
+    makeupGain = juce::Decibels::decibelsToGain (raw.makeupDb->load(), -200.0f);
+
+    const bool split = static_cast<int> (raw.duckMode->load()) == 1;
+
+    // Filter state left over from the last time the split was on means nothing now.
+    if (split && ! splitBands)
+    {
+        floatPath.crossover.reset();
+        doublePath.crossover.reset();
+        floatPath.unduckedPhase.reset();
+        doublePath.unduckedPhase.reset();
+    }
+
+    splitBands = split;
+
+    updateDuckedChannels ((raw.duckFronts->load() >= 0.5f ? frontGroup : 0)
+                          | (raw.duckLfe->load() >= 0.5f ? lfeGroup : 0)
+                          | (raw.duckSurrounds->load() >= 0.5f ? surroundGroup : 0)
+                          | (raw.duckHeights->load() >= 0.5f ? heightGroup : 0));
 
-    const float reduction = over - (over / juce::jmax (1.0f, ratio));
-    return -juce::jmin (depthDb, reduction);
+    const auto crossoverHz = raw.crossoverHz->load();
+    floatPath.crossover.setFrequency (crossoverHz);
+    doublePath.crossover.setFrequency (crossoverHz);
+    floatPath.unduckedPhase.setFrequency (crossoverHz);
+    doublePath.unduckedPhase.setFrequency (crossoverHz);
 }
 
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
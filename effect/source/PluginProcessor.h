@@ -1,16 +1,27 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <array>
 #include <atomic>
 #include <vector>
 #include <juce_dsp/juce_dsp.h>
 #include "dsp/LookaheadDetector.h"
-
-class TriBaseAudioProcessor : public juce::AudioProcessor
+#include "dsp/GainComputer.h"
+#include "dsp/GainTelemetry.h"
+#include "dsp/LookaheadDelay.h"
+#include "dsp/Crossover.h"
+#include "dsp/MidiDuck.h"
+#include "dsp/HitTemplate.h"
+#include "dsp/TempoCurve.h"
+#include "dsp/SidechainBank.h"
+#include "dsp/SpectralDucker.h"
+
+class TriBaseAudioProcessor : public juce::AudioProcessor,
+                              private juce::Timer
 {
 public:
     TriBaseAudioProcessor();
-    ~TriBaseAudioProcessor() override = default;
+    ~TriBaseAudioProcessor() override { stopTimer(); }
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
@@ -47,36 +58,158 @@ public:
     std::atomic<float> scLevel { 0.0f };
     std::atomic<float> meterScDb { -60.0f };
     std::atomic<float> meterGrDb { 0.0f };
+    // The scope's trace, a point every GainTelemetry::pointSpacing samples.
+    GainTelemetry telemetry;
 
     double sampleRateHz { 44100.0 };
     int maxBlock { 512 };
-    int latencySamples { 0 };
+    // Written on the audio thread; reported to the host from timerCallback().
+    std::atomic<int> latencySamples { 0 };
 
     bool hasSidechainEnabled() const;
 
+    // The first sidechain bus plus the extra inputs; each one is a lane of the SidechainBank.
+    static constexpr int numSidechainInputs = SidechainBank<float>::lanes;
+
 private:
+    template <typename FloatType>
+    void processBlockInternal (juce::AudioBuffer<FloatType>&, juce::MidiBuffer&);
+
+    // One span of at most maxBlock samples, starting midiOffset samples into the host's
+    // block, which is where its events in midiMessages are found.
+    template <typename FloatType>
+    void processSpan (juce::AudioBuffer<FloatType>&, const juce::MidiBuffer&, int midiOffset);
+
+    // Matches the "triggerSource" choices.
+    enum class TriggerSource { sidechain, midi, predictive, tempo };
+
+    void timerCallback() override;
+
     void applyParamUpdatesIfChanged();
+    void updateDetectorSettings();
+    int computeLatencySamples (float lookaheadMs) const;
+    void updateLatency (float lookaheadMs);
     void refreshParams();
-    float computeGainDb (float detectorDb);
-
-    LookaheadDetector detector;
+    DetectorMode getDetectorMode() const;
+    TriggerSource getTriggerSource() const;
+    bool isSpectralDucking() const;
+    void updateScMeter (float peak) noexcept;
+    void syncTempoCurve();
+
+    bool hasExtraSidechainEnabled() const;
+
+    // Main-bus channel groups that can be ducked independently, as bits of a mask.
+    enum ChannelGroup
+    {
+        frontGroup    = 1 << 0,
+        lfeGroup      = 1 << 1,
+        surroundGroup = 1 << 2,
+        heightGroup   = 1 << 3
+    };
+
+    // Enough for 7.1.4, the widest main layout accepted.
+    static constexpr int maxMainChannels = 16;
+
+    // Samples the detector produces per call inside the gain loop: a whole number of gain
+    // tiles, short enough that its buffers stay in L1.
+    static constexpr int detectorSpan = 8 * GainComputer::tileSize;
+
+    static int getChannelGroup (juce::AudioChannelSet::ChannelType type);
+    static float getSidechainWeight (juce::AudioChannelSet::ChannelType type);
+    void updateDuckedChannels (int groupMask);
+
+    // Detector, lookahead delay and crossover for one processing precision. Both sets are
+    // prepared, so each processBlock overload runs natively without converting its buffers.
+    template <typename FloatType>
+    struct LookaheadPath
+    {
+        LookaheadDetector<FloatType> detector;
+        SidechainBank<FloatType> sidechains;
+        LookaheadDelay<FloatType> delay;
+        Crossover<FloatType> crossover;
+        // The crossover's allpass alone, for the channels low-band mode leaves unducked.
+        Crossover<FloatType> unduckedPhase;
+        SpectralDucker<FloatType> spectral;
+
+        // One block of the final gain, applied to every ducked channel in a single pass.
+        std::vector<FloatType> gains;
+
+        // The main sidechain, downmixed by the detector before it joins the bank.
+        std::vector<FloatType> mainDownmix;
+    };
+
+    template <typename FloatType>
+    LookaheadPath<FloatType>& getLookaheadPath() noexcept;
+
+    LookaheadPath<float> floatPath;
+    LookaheadPath<double> doublePath;
+    GainComputer gainComputer;
+    MidiDuck midiDuck;
+    HitTemplate hitTemplate;
+    TempoCurve tempoCurve;
     float prevLookaheadMs { -1.0f };
+    bool prevMultirate { false };
+    bool prevFixedLatency { false };
+    TriggerSource triggerSource { TriggerSource::sidechain };
+    bool spectralDucking { false };
+    int reportedLatency { 0 };
+
+    // Group bits per main-bus channel, from the layout at prepare time, and the channels
+    // whose groups are currently ducked and not ducked.
+    std::vector<int> channelGroups;
+    std::vector<int> duckedChannels;
+    std::vector<int> unduckedChannels;
+    int duckGroupMask { -1 };
+
+    // Looked up once; getRawParameterValue (String) allocates and searches a map.
+    struct RawParams
+    {
+        std::atomic<float>* lookaheadMs = nullptr;
+        std::atomic<float>* detectorMode = nullptr;
+        std::atomic<float>* rmsWindowMs = nullptr;
+        std::atomic<float>* scFilterType = nullptr;
+        std::atomic<float>* scFilterLoHz = nullptr;
+        std::atomic<float>* scFilterHiHz = nullptr;
+        std::atomic<float>* scLink = nullptr;
+        std::atomic<float>* scMultirate = nullptr;
+        std::atomic<float>* fixedLatency = nullptr;
+        std::atomic<float>* threshold = nullptr;
+        std::atomic<float>* ratio = nullptr;
+        std::atomic<float>* kneeDb = nullptr;
+        std::atomic<float>* attackMs = nullptr;
+        std::atomic<float>* releaseMs = nullptr;
+        std::atomic<float>* depthDb = nullptr;
+        std::atomic<float>* mix = nullptr;
+        std::atomic<float>* makeupDb = nullptr;
+        std::atomic<float>* duckMode = nullptr;
+        std::atomic<float>* crossoverHz = nullptr;
+        std::atomic<float>* triggerSource = nullptr;
+        std::atomic<float>* syncRate = nullptr;
+        std::atomic<float>* pumpRecovery = nullptr;
+        std::atomic<float>* pumpCurve = nullptr;
+        std::atomic<float>* scCombine = nullptr;
+        std::atomic<float>* duckFronts = nullptr;
+        std::atomic<float>* duckLfe = nullptr;
+        std::atomic<float>* duckSurrounds = nullptr;
+        std::atomic<float>* duckHeights = nullptr;
+
+        // Per extra sidechain input, "Sidechain 2" onwards.
+        struct ExtraSidechain
+        {
+            std::atomic<float>* filterType = nullptr;
+            std::atomic<float>* filterLoHz = nullptr;
+            std::atomic<float>* filterHiHz = nullptr;
+            std::atomic<float>* threshold = nullptr;
+            std::atomic<float>* depthDb = nullptr;
+        };
+
+        std::array<ExtraSidechain, numSidechainInputs - 1> extraSc;
+    } raw;
 
     // user params cached
-    float threshDb { -24.0f };
-    float ratio { 4.0f };
-    float atkMs { 5.0f };
-    float relMs { 120.0f };
-    float depthDb { 18.0f };
     float mix { 1.0f };
-    float makeupDb { 0.0f };
-
-    // smoothing
-    float envDb { -96.0f };
-    float grDb { 0.0f };
-
-    // lookahead audio
-    std::vector<juce::dsp::DelayLine<float>> delayLanes;
+    float makeupGain { 1.0f };
+    bool splitBands { false };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TriBaseAudioProcessor)
 };
@@ -85,9 +218,54 @@ inline TriBaseAudioProcessor::TriBaseAudioProcessor()
     : juce::AudioProcessor (BusesProperties()
                                .withInput ("Main In", juce::AudioChannelSet::stereo(), true)
                                .withOutput ("Main Out", juce::AudioChannelSet::stereo(), true)
-                               .withInput ("Sidechain", juce::AudioChannelSet::stereo(), false)),
+                               .withInput ("Sidechain", juce::AudioChannelSet::stereo(), false)
+                               .withInput ("Sidechain 2", juce::AudioChannelSet::stereo(), false)
+                               .withInput ("Sidechain 3", juce::AudioChannelSet::stereo(), false)
+                               .withInput ("Sidechain 4", juce::AudioChannelSet::stereo(), false)),
       apvts (*this, nullptr, "Parameters", createParameterLayout())
 {
+    raw.lookaheadMs  = apvts.getRawParameterValue ("lookaheadMs");
+    raw.detectorMode = apvts.getRawParameterValue ("detectorMode");
+    raw.rmsWindowMs  = apvts.getRawParameterValue ("rmsWindowMs");
+    raw.scFilterType = apvts.getRawParameterValue ("scFilterType");
+    raw.scFilterLoHz = apvts.getRawParameterValue ("scFilterLoHz");
+    raw.scFilterHiHz = apvts.getRawParameterValue ("scFilterHiHz");
+    raw.scLink       = apvts.getRawParameterValue ("scLink");
+    raw.scMultirate  = apvts.getRawParameterValue ("scMultirate");
+    raw.fixedLatency = apvts.getRawParameterValue ("fixedLatency");
+    raw.threshold    = apvts.getRawParameterValue ("threshold");
+    raw.ratio        = apvts.getRawParameterValue ("ratio");
+    raw.kneeDb       = apvts.getRawParameterValue ("kneeDb");
+    raw.attackMs     = apvts.getRawParameterValue ("attackMs");
+    raw.releaseMs    = apvts.getRawParameterValue ("releaseMs");
+    raw.depthDb      = apvts.getRawParameterValue ("depthDb");
+    raw.mix          = apvts.getRawParameterValue ("mix");
+    raw.makeupDb     = apvts.getRawParameterValue ("makeupDb");
+    raw.duckMode     = apvts.getRawParameterValue ("duckMode");
+    raw.crossoverHz  = apvts.getRawParameterValue ("crossoverHz");
+    raw.triggerSource = apvts.getRawParameterValue ("triggerSource");
+    raw.syncRate     = apvts.getRawParameterValue ("syncRate");
+    raw.pumpRecovery = apvts.getRawParameterValue ("pumpRecovery");
+    raw.pumpCurve    = apvts.getRawParameterValue ("pumpCurve");
+    raw.scCombine    = apvts.getRawParameterValue ("scCombine");
+    raw.duckFronts   = apvts.getRawParameterValue ("duckFronts");
+    raw.duckLfe      = apvts.getRawParameterValue ("duckLfe");
+    raw.duckSurrounds = apvts.getRawParameterValue ("duckSurrounds");
+    raw.duckHeights  = apvts.getRawParameterValue ("duckHeights");
+
+    for (size_t i = 0; i < raw.extraSc.size(); ++i)
+    {
+        const auto prefix = "sc" + juce::String (static_cast<int> (i) + 2);
+        auto& sc = raw.extraSc[i];
+
+        sc.filterType = apvts.getRawParameterValue (prefix + "FilterType");
+        sc.filterLoHz = apvts.getRawParameterValue (prefix + "FilterLoHz");
+        sc.filterHiHz = apvts.getRawParameterValue (prefix + "FilterHiHz");
+        sc.threshold  = apvts.getRawParameterValue (prefix + "Threshold");
+        sc.depthDb    = apvts.getRawParameterValue (prefix + "DepthDb");
+    }
+
+    startTimerHz (10);
 }
 
 inline bool TriBaseAudioProcessor::hasSidechainEnabled() const
@@ -98,6 +276,15 @@ inline bool TriBaseAudioProcessor::hasSidechainEnabled() const
     return false;
 }
 
+inline bool TriBaseAudioProcessor::hasExtraSidechainEnabled() const
+{
+    for (int index = 2; index <= numSidechainInputs; ++index)
+        if (auto* bus = getBus (true, index); bus != nullptr && bus->isEnabled())
+            return true;
+
+    return false;
+}
+
 inline juce::AudioProcessorValueTreeState::ParameterLayout TriBaseAudioProcessor::createParameterLayout()
 {
     juce::AudioProcessorValueTreeState::ParameterLayout layout;
@@ -111,9 +298,15 @@ inline juce::AudioProcessorValueTreeState::ParameterLayout TriBaseAudioProcessor
     layout.add (std::make_unique<juce::AudioParameterChoice>(
         "detectorMode",
         "Detector Mode",
-        juce::StringArray { "RMS", "Peak" },
+        juce::StringArray { "Smoothed", "Smoothed Peak", "RMS", "Peak Hold" },
         0));
 
+    layout.add (std::make_unique<juce::AudioParameterFloat>(
+        "rmsWindowMs",
+        "RMS Window (ms)",
+        juce::NormalisableRange<float> (1.0f, 50.0f),
+        10.0f));
+
     layout.add (std::make_unique<juce::AudioParameterChoice>(
         "scFilterType",
         "SC Filter Type",
@@ -132,6 +325,22 @@ inline juce::AudioProcessorValueTreeState::ParameterLayout TriBaseAudioProcessor
         juce::NormalisableRange<float> (80.0f, 150.0f),
         120.0f));
 
+    layout.add (std::make_unique<juce::AudioParameterChoice>(
+        "scLink",
+        "SC Channel Link",
+        juce::StringArray { "Sum", "Max" },
+        0));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        "scMultirate",
+        "SC Multirate",
+        false));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        "fixedLatency",
+        "Fixed Latency",
+        false));
+
     layout.add (std::make_unique<juce::AudioParameterFloat>(
         "threshold",
         "Threshold (dB)",
@@ -144,6 +353,12 @@ inline juce::AudioProcessorValueTreeState::ParameterLayout TriBaseAudioProcessor
         juce::NormalisableRange<float> (1.0f, 20.0f),
         4.0f));
 
+    layout.add (std::make_unique<juce::AudioParameterFloat>(
+        "kneeDb",
+        "Knee (dB)",
+        juce::NormalisableRange<float> (0.0f, 24.0f),
+        0.0f));
+
     layout.add (std::make_unique<juce::AudioParameterFloat>(
         "attackMs",
         "Attack (ms)",
@@ -174,5 +389,104 @@ inline juce::AudioProcessorValueTreeState::ParameterLayout TriBaseAudioProcessor
         juce::NormalisableRange<float> (-24.0f, 24.0f),
         0.0f));
 
+    layout.add (std::make_unique<juce::AudioParameterChoice>(
+        "duckMode",
+        "Duck Mode",
+        juce::StringArray { "Broadband", "Low Band", "Spectral" },
+        0));
+
+    layout.add (std::make_unique<juce::AudioParameterFloat>(
+        "crossoverHz",
+        "Crossover (Hz)",
+        juce::NormalisableRange<float> (40.0f, 300.0f),
+        120.0f));
+
+    layout.add (std::make_unique<juce::AudioParameterChoice>(
+        "triggerSource",
+        "Trigger Source",
+        juce::StringArray { "Sidechain", "MIDI", "Predictive", "Tempo" },
+        0));
+
+    layout.add (std::make_unique<juce::AudioParameterChoice>(
+        "syncRate",
+        "Sync Rate",
+        juce::StringArray { "1/1", "1/2", "1/4", "1/8", "1/16" },
+        2));
+
+    layout.add (std::make_unique<juce::AudioParameterFloat>(
+        "pumpRecovery",
+        "Pump Recovery (%)",
+        juce::NormalisableRange<float> (10.0f, 100.0f),
+        60.0f));
+
+    layout.add (std::make_unique<juce::AudioParameterFloat>(
+        "pumpCurve",
+        "Pump Curve",
+        juce::NormalisableRange<float> (0.0f, 1.0f),
+        0.5f));
+
+    layout.add (std::make_unique<juce::AudioParameterChoice>(
+        "scCombine",
+        "SC Combine",
+        juce::StringArray { "Max", "Sum" },
+        0));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        "duckFronts",
+        "Duck Fronts",
+        true));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        "duckLfe",
+        "Duck LFE",
+        true));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        "duckSurrounds",
+        "Duck Surrounds",
+        true));
+
+    layout.add (std::make_unique<juce::AudioParameterBool>(
+        "duckHeights",
+        "Duck Heights",
+        true));
+
+    // The extra sidechain inputs share one set of ranges with the first.
+    for (int input = 2; input <= numSidechainInputs; ++input)
+    {
+        const auto id = "sc" + juce::String (input);
+        const auto name = "SC" + juce::String (input) + " ";
+
+        layout.add (std::make_unique<juce::AudioParameterChoice>(
+            id + "FilterType",
+            name + "Filter Type",
+            juce::StringArray { "Off", "HPF", "BP" },
+            0));
+
+        layout.add (std::make_unique<juce::AudioParameterFloat>(
+            id + "FilterLoHz",
+            name + "Filter Lo (Hz)",
+            juce::NormalisableRange<float> (20.0f, 80.0f),
+            30.0f));
+
+        layout.add (std::make_unique<juce::AudioParameterFloat>(
+            id + "FilterHiHz",
+            name + "Filter Hi (Hz)",
+            juce::NormalisableRange<float> (80.0f, 150.0f),
+            120.0f));
+
+        layout.add (std::make_unique<juce::AudioParameterFloat>(
+            id + "Threshold",
+            name + "Threshold (dB)",
+            juce::NormalisableRange<float> (-60.0f, 0.0f),
+            -24.0f));
+
+        layout.add (std::make_unique<juce::AudioParameterFloat>(
+            id + "DepthDb",
+            name + "Depth (dB)",
+            juce::NormalisableRange<float> (0.0f, 48.0f),
+            18.0f));
+    }
+
     return layout;
 }
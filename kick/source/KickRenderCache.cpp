@@ -0,0 +1,241 @@
+#include "KickRenderCache.h"
+#include <bit>
+
+namespace
+{
+constexpr int kPollMs = 20;
+constexpr int kRenderChunk = 512;
+constexpr double kFadeSec = 0.005;
+
+constexpr std::uint32_t playerBit (int player) noexcept { return 1u << static_cast<unsigned> (player); }
+constexpr std::uint32_t kAllPlayers = (1u << KickVoicePool::lanes) - 1u;
+}
+
+KickRenderCache::KickRenderCache()
+    : juce::Thread ("TriBase Kick Render")
+{
+}
+
+KickRenderCache::~KickRenderCache()
+{
+    stopThread (1000);
+}
+
+void KickRenderCache::prepare (double newSampleRate)
+{
+    stopThread (1000);
+
+    sampleRate = juce::jmax (1.0, newSampleRate);
+    capacity = static_cast<int> (std::ceil (maxSeconds * sampleRate));
+    fadeStep = static_cast<float> (1.0 / (kFadeSec * sampleRate));
+    renderer.prepare (sampleRate);
+
+    for (auto& slot : slots)
+    {
+        slot.samples.assign (static_cast<size_t> (capacity), 0.0f);
+        slot.state.store (empty);
+        slot.length = 0;
+    }
+
+    activePlayers = 0;
+    startThread (juce::Thread::Priority::low);
+}
+
+void KickRenderCache::release()
+{
+    stopThread (1000);
+    activePlayers = 0;
+}
+
+std::uint64_t KickRenderCache::makeKey (const KickParams& params) noexcept
+{
+    // FNV-1a over the exact bit patterns: any change at all is a different kick.
+    const double fields[] = { params.clickLevel, params.bodyStartHz, params.bodyEndHz, params.bodyTimeSec,
+                              params.bodyCurve, params.toneHz, params.driveGain, params.tailLevel,
+                              params.tailDecaySec, params.outputGain };
+
+    std::uint64_t hash = 14695981039346656037ull;
+
+    for (const auto field : fields)
+    {
+        hash ^= std::bit_cast<std::uint64_t> (field);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+bool KickRenderCache::isSlotPlaying (int slot) const noexcept
+{
+    for (int player = 0; player < KickVoicePool::lanes; ++player)
+        if ((activePlayers & playerBit (player)) != 0 && players[static_cast<size_t> (player)].slot == slot)
+            return true;
+
+    return false;
+}
+
+bool KickRenderCache::trigger (std::uint64_t key, double velocity) noexcept
+{
+    int slot = 0;
+
+    while (slot < numSlots && ! (slots[static_cast<size_t> (slot)].state.load (std::memory_order_acquire) == ready
+                                 && slots[static_cast<size_t> (slot)].key == key))
+        ++slot;
+
+    if (slot == numSlots)
+        return false;
+
+    // A free player, else the quietest fading one, else the oldest.
+    int player = 0;
+    const auto freePlayers = ~activePlayers & kAllPlayers;
+
+    if (freePlayers != 0)
+    {
+        while ((freePlayers & playerBit (player)) == 0)
+            ++player;
+    }
+    else
+    {
+        for (int other = 1; other < KickVoicePool::lanes; ++other)
+        {
+            const auto& candidate = players[static_cast<size_t> (other)];
+            const auto& best = players[static_cast<size_t> (player)];
+
+            if (candidate.fading != best.fading ? candidate.fading
+                                                : (candidate.fading ? candidate.fade < best.fade : candidate.startedAt < best.startedAt))
+                player = other;
+        }
+    }
+
+    auto& started = players[static_cast<size_t> (player)];
+    started.slot = slot;
+    started.position = 0;
+    started.gain = static_cast<float> (juce::jlimit (0.0, 1.0, velocity));
+    started.fade = 1.0f;
+    started.fading = false;
+    started.startedAt = ++triggerCount;
+    activePlayers |= playerBit (player);
+
+    // As in the voice pool: taking the last player fades the oldest one out.
+    if (activePlayers == kAllPlayers)
+    {
+        Player* oldest = nullptr;
+
+        for (int other = 0; other < KickVoicePool::lanes; ++other)
+        {
+            auto& candidate = players[static_cast<size_t> (other)];
+
+            if (other != player && ! candidate.fading && (oldest == nullptr || candidate.startedAt < oldest->startedAt))
+                oldest = &candidate;
+        }
+
+        if (oldest != nullptr)
+            oldest->fading = true;
+    }
+
+    return true;
+}
+
+void KickRenderCache::request (const KickParams& params, std::uint64_t key) noexcept
+{
+    int victim = -1;
+
+    for (int index = 0; index < numSlots; ++index)
+    {
+        auto& slot = slots[static_cast<size_t> (index)];
+        const int state = slot.state.load (std::memory_order_acquire);
+
+        if (state != empty && slot.key == key)
+            return;
+
+        if (state == requested || isSlotPlaying (index))
+            continue;
+
+        // Empty slots first, then whichever ready slot comes first; with numSlots notes
+        // in rotation that is rarely one still wanted.
+        if (victim < 0 || state == empty)
+            victim = index;
+    }
+
+    if (victim < 0)
+        return;
+
+    auto& slot = slots[static_cast<size_t> (victim)];
+    slot.key = key;
+    slot.params = params;
+    slot.state.store (requested, std::memory_order_release);
+}
+
+void KickRenderCache::renderBlock (float* out, int numSamples) noexcept
+{
+    for (int index = 0; index < KickVoicePool::lanes; ++index)
+    {
+        if ((activePlayers & playerBit (index)) == 0)
+            continue;
+
+        auto& player = players[static_cast<size_t> (index)];
+        const auto& slot = slots[static_cast<size_t> (player.slot)];
+        const float* source = slot.samples.data() + player.position;
+        int n = juce::jmin (numSamples, slot.length - player.position);
+
+        if (player.fading)
+        {
+            n = juce::jmin (n, static_cast<int> (std::ceil (player.fade / fadeStep)));
+
+            for (int i = 0; i < n; ++i)
+            {
+                out[i] += source[i] * player.gain * player.fade;
+                player.fade = juce::jmax (0.0f, player.fade - fadeStep);
+            }
+        }
+        else
+        {
+            juce::FloatVectorOperations::addWithMultiply (out, source, player.gain, n);
+        }
+
+        player.position += n;
+
+        if (player.position >= slot.length || (player.fading && player.fade <= 0.0f))
+            activePlayers &= ~playerBit (index);
+    }
+}
+
+void KickRenderCache::run()
+{
+    while (! threadShouldExit())
+    {
+        for (auto& slot : slots)
+        {
+            if (threadShouldExit())
+                return;
+
+            if (slot.state.load (std::memory_order_acquire) == requested)
+                renderSlot (slot);
+        }
+
+        wait (kPollMs);
+    }
+}
+
+void KickRenderCache::renderSlot (Slot& slot)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    renderer.reset();
+    renderer.setTargetParameters (slot.params);
+    renderer.trigger (slot.params, 1.0);
+
+    float* samples = slot.samples.data();
+    int length = 0;
+
+    while (renderer.isActive() && length < capacity)
+    {
+        const int n = juce::jmin (kRenderChunk, capacity - length);
+        juce::FloatVectorOperations::clear (samples + length, n);
+        renderer.renderBlock (samples + length, n);
+        length += n;
+    }
+
+    slot.length = length;
+    slot.state.store (renderer.isActive() ? tooLong : ready, std::memory_order_release);
+}
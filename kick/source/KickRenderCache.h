@@ -0,0 +1,101 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "KickVoicePool.h"
+
+// Whole one-shot renders of the kick, so hits with settled parameters play back from
+// memory instead of being synthesised.
+//
+// A hit is a function of its KickParams and lane alone (the pool reseeds a lane's click
+// noise on every hit), so a render keyed by a hash of the parameters stands in for every
+// later hit with the same key; a live hit on another lane differs only in which noise
+// its click draws. Velocity only scales the output while the pool's output limiter stays
+// out of the way, so only parameters that canCache() accepts are rendered, once, at unit
+// velocity. Renders are made on a background thread into slots allocated in prepare().
+//
+// Each slot changes hands through its state alone: the audio thread claims an empty or
+// unplayed slot, fills in the parameters and marks it requested; the render thread, which
+// polls rather than waits so the audio thread never has to signal it, renders it and marks
+// it ready. Neither side touches a slot the other owns, so nothing on the audio thread
+// locks or allocates.
+//
+// Playback mixes up to KickVoicePool::lanes hits and steals the same way the pool does.
+class KickRenderCache : private juce::Thread
+{
+public:
+    static constexpr int numSlots = 4;
+    static constexpr double maxSeconds = 4.0;
+
+    KickRenderCache();
+    ~KickRenderCache() override;
+
+    // Stops the render thread, reallocates for the new rate and starts it again.
+    void prepare (double newSampleRate);
+    void release();
+
+    static std::uint64_t makeKey (const KickParams& params) noexcept;
+
+    // Whether hits with these parameters and velocities up to 1 sound the same from the
+    // cache as live: true unless the output limiter could act on them.
+    static bool canCache (const KickParams& params) noexcept { return ! KickVoicePool::mayClip (params, 1.0); }
+
+    // Audio thread. Starts a hit from the slot holding key, if one is ready.
+    bool trigger (std::uint64_t key, double velocity) noexcept;
+
+    // Audio thread. Asks for key to be rendered unless it already is, or is on its way.
+    void request (const KickParams& params, std::uint64_t key) noexcept;
+
+    // Audio thread. Adds numSamples of all playing hits to out.
+    void renderBlock (float* out, int numSamples) noexcept;
+
+    bool isActive() const noexcept { return activePlayers != 0; }
+
+private:
+    enum SlotState
+    {
+        empty,
+        requested,
+        ready,
+        tooLong   // rang on past maxSeconds; kept so it is not asked for again
+    };
+
+    struct Slot
+    {
+        std::vector<float> samples;
+        std::atomic<int> state { empty };
+        std::uint64_t key = 0;
+        KickParams params;
+        int length = 0;
+    };
+
+    struct Player
+    {
+        int slot = 0;
+        int position = 0;
+        float gain = 0.0f;
+        float fade = 1.0f;
+        bool fading = false;
+        std::uint64_t startedAt = 0;
+    };
+
+    void run() override;
+    void renderSlot (Slot& slot);
+    bool isSlotPlaying (int slot) const noexcept;
+
+    double sampleRate = 44100.0;
+    int capacity = 0;
+    float fadeStep = 1.0f;
+
+    std::array<Slot, numSlots> slots;
+    KickVoicePool renderer;
+
+    std::array<Player, KickVoicePool::lanes> players;
+    std::uint32_t activePlayers = 0;
+    std::uint64_t triggerCount = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (KickRenderCache)
+};
@@ -0,0 +1,412 @@
+#include "KickVoicePool.h"
+#include "dsp/FastMath.h"
+
+namespace
+{
+constexpr double kSmoothingSec = 0.02;
+constexpr double kFadeSec = 0.005;
+constexpr double kBodyDecay = 5.0;   // the body envelope is exp (-5 * progress)
+constexpr float kClickFilter = 0.15f;
+constexpr float kClickGain = 0.6f;
+constexpr float kOutputLimit = 1.2f;
+constexpr float kSilence = 1.0e-4f;
+
+constexpr std::uint32_t laneBit (int lane) noexcept { return 1u << static_cast<unsigned> (lane); }
+constexpr std::uint32_t kAllLanes = (1u << KickVoicePool::lanes) - 1u;
+constexpr std::uint32_t kGroupLanes = (1u << KickVoicePool::groupSize) - 1u;
+
+// Bits of a group's stage set, and so of its index into groupRenderers.
+constexpr int kClickStage = 1;
+constexpr int kTailStage = 2;
+constexpr int kFadeStage = 4;
+
+// Distinct, non-zero seeds so overlapping clicks are uncorrelated.
+constexpr std::uint32_t laneSeed (int lane) noexcept
+{
+    return 0x9e3779b9u * static_cast<std::uint32_t> (lane + 1);
+}
+
+// Rounds to phase units, wrapping negative steps to their two's complement.
+std::uint32_t toPhaseUnits (double value) noexcept
+{
+    return static_cast<std::uint32_t> (std::llround (value));
+}
+
+// The top 24 bits of a phase as cycles in [0, 1); a signed conversion, so it vectorises.
+inline float toCycles (std::uint32_t phase) noexcept
+{
+    return static_cast<float> (static_cast<std::int32_t> (phase >> 8)) * (1.0f / 16777216.0f);
+}
+}
+
+void KickVoicePool::prepare (double newSampleRate)
+{
+    sampleRate = juce::jmax (1.0, newSampleRate);
+    smoothingSamples = kSmoothingSec * sampleRate;
+    phaseScale = 4294967296.0 / sampleRate;
+    fadeStep = static_cast<float> (1.0 / (kFadeSec * sampleRate));
+    reset();
+}
+
+void KickVoicePool::reset()
+{
+    activeMask = 0;
+    fadingMask = 0;
+
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        noiseState[lane] = laneSeed (lane);
+        normDrive[static_cast<size_t> (lane)] = -1.0;
+        toneState[lane] = 0.0f;
+        clickLP[lane] = 0.0f;
+        silenceLane (lane);
+    }
+}
+
+void KickVoicePool::setTargetParameters (const KickParams& newTarget)
+{
+    for (auto& laneTarget : target)
+    {
+        const auto startHz = laneTarget.bodyStartHz;
+        const auto endHz = laneTarget.bodyEndHz;
+
+        laneTarget = newTarget;
+        laneTarget.bodyStartHz = startHz;
+        laneTarget.bodyEndHz = endHz;
+    }
+}
+
+void KickVoicePool::trigger (const KickParams& params, double vel)
+{
+    int lane = 0;
+    const auto freeLanes = ~activeMask & kAllLanes;
+
+    if (freeLanes != 0)
+    {
+        while ((freeLanes & laneBit (lane)) == 0)
+            ++lane;
+    }
+    else
+    {
+        lane = findLaneToSteal();
+    }
+
+    const auto index = static_cast<size_t> (lane);
+
+    target[index] = params;
+    current[index] = params;
+    velocity[index] = juce::jlimit (0.0, 2.0, vel);
+    startedAt[index] = ++triggerCount;
+
+    time[index] = 0.0;
+    clickTime[index] = 0.0;
+    tailDecay[index] = params.tailLevel;
+    bodyPhase[lane] = 0;
+    tailPhase[lane] = 0;
+    toneState[lane] = 0.0f;
+    clickLP[lane] = 0.0f;
+    noiseState[lane] = laneSeed (lane);
+    fade[lane] = 1.0f;
+
+    activeMask |= laneBit (lane);
+    fadingMask &= ~laneBit (lane);
+
+    // Taking the last free lane: fade the oldest voice out so the next hit has somewhere
+    // to go without a hard steal.
+    if (activeMask == kAllLanes)
+    {
+        int oldest = -1;
+
+        for (int other = 0; other < lanes; ++other)
+            if (other != lane && (fadingMask & laneBit (other)) == 0
+                && (oldest < 0 || startedAt[static_cast<size_t> (other)] < startedAt[static_cast<size_t> (oldest)]))
+                oldest = other;
+
+        if (oldest >= 0)
+            fadingMask |= laneBit (oldest);
+    }
+}
+
+bool KickVoicePool::mayClip (const KickParams& params, double vel) noexcept
+{
+    // The tone filter averages its input, so it never exceeds the body, tail and click
+    // peaks added together; the click is high-passed noise, so it can swing twice its level.
+    const double peakIn = 1.0 + juce::jmax (0.0, params.tailLevel) + 2.0 * juce::jmax (0.0, params.clickLevel) * kClickGain;
+    const double drive = juce::jmax (1.0, params.driveGain);
+    const double peakOut = std::tanh (drive * peakIn) / std::tanh (drive) * params.outputGain * juce::jlimit (0.0, 2.0, vel);
+
+    // A little headroom for fastmath::tanh, which may overshoot std::tanh slightly.
+    return peakOut > kOutputLimit * 0.999;
+}
+
+int KickVoicePool::findLaneToSteal() const noexcept
+{
+    // The quietest fading voice if there is one, otherwise the oldest.
+    int best = 0;
+
+    for (int lane = 1; lane < lanes; ++lane)
+    {
+        const bool laneFading = (fadingMask & laneBit (lane)) != 0;
+        const bool bestFading = (fadingMask & laneBit (best)) != 0;
+
+        if (laneFading != bestFading)
+        {
+            if (laneFading)
+                best = lane;
+        }
+        else if (laneFading ? fade[lane] < fade[best]
+                            : startedAt[static_cast<size_t> (lane)] < startedAt[static_cast<size_t> (best)])
+        {
+            best = lane;
+        }
+    }
+
+    return best;
+}
+
+double KickVoicePool::applyCurve (double t, double curve)
+{
+    t = juce::jlimit (0.0, 1.0, t);
+    if (curve < 0.0)
+    {
+        const double k = 1.0 + (-curve * 4.0);
+        return 1.0 - std::pow (1.0 - t, k);
+    }
+
+    if (curve > 0.0)
+    {
+        const double k = 1.0 + (curve * 4.0);
+        return std::pow (t, k);
+    }
+
+    return t;
+}
+
+double KickVoicePool::getBodyHz (const KickParams& params, double atTime) noexcept
+{
+    const double prog = juce::jlimit (0.0, 1.0, atTime / params.bodyTimeSec);
+    const double shaped = applyCurve (prog, params.bodyCurve);
+    return juce::jlimit (20.0, 4000.0, juce::jmap (shaped, 0.0, 1.0, params.bodyStartHz, params.bodyEndHz));
+}
+
+void KickVoicePool::renderBlock (float* out, int numSamples) noexcept
+{
+    for (int start = 0; start < numSamples && isActive(); start += controlBlock)
+        renderControlBlock (out + start, juce::jmin (controlBlock, numSamples - start));
+}
+
+void KickVoicePool::silenceLane (int lane) noexcept
+{
+    // Idle lanes in a sounding group still run through the loop; these keep them silent.
+    bodyInc[lane] = bodyStep[lane] = tailInc[lane] = 0;
+    bodyEnv[lane] = bodyMul[lane] = bodyFloor[lane] = 0.0f;
+    tailEnv[lane] = 0.0f;
+    tailMul[lane] = 1.0f;
+    clickLevel[lane] = 0.0f;
+    clickSamples[lane] = 0;
+    toneCoeff[lane] = 1.0f;
+    driveGain[lane] = 1.0f;
+    outGain[lane] = 0.0f;
+    laneFadeStep[lane] = 0.0f;
+    fade[lane] = 0.0f;
+}
+
+void KickVoicePool::setupLane (int lane, int numSamples, double smoothing) noexcept
+{
+    const auto index = static_cast<size_t> (lane);
+    auto& cur = current[index];
+    const auto& tgt = target[index];
+
+    const auto smooth = [smoothing] (double& value, double targetValue) noexcept
+    {
+        value += smoothing * (targetValue - value);
+    };
+
+    smooth (cur.clickLevel, tgt.clickLevel);
+    smooth (cur.bodyStartHz, tgt.bodyStartHz);
+    smooth (cur.bodyEndHz, tgt.bodyEndHz);
+    smooth (cur.bodyTimeSec, tgt.bodyTimeSec);
+    smooth (cur.bodyCurve, tgt.bodyCurve);
+    smooth (cur.toneHz, tgt.toneHz);
+    smooth (cur.driveGain, tgt.driveGain);
+    smooth (cur.tailLevel, tgt.tailLevel);
+    smooth (cur.tailDecaySec, tgt.tailDecaySec);
+    smooth (cur.outputGain, tgt.outputGain);
+
+    const double dt = 1.0 / sampleRate;
+    const double t = time[index];
+
+    // The body's pitch is evaluated on the control grid and ramped between, and both
+    // envelopes restart from exact values each block so they never drift.
+    const double bodyHz = getBodyHz (cur, t);
+    const double nextBodyHz = getBodyHz (cur, t + numSamples * dt);
+    bodyInc[lane] = toPhaseUnits (bodyHz * phaseScale);
+    bodyStep[lane] = toPhaseUnits ((nextBodyHz - bodyHz) * phaseScale / numSamples);
+    bodyEnv[lane] = static_cast<float> (std::exp (-kBodyDecay * juce::jmin (1.0, t / cur.bodyTimeSec)));
+    bodyMul[lane] = static_cast<float> (std::exp (-kBodyDecay * dt / cur.bodyTimeSec));
+    bodyFloor[lane] = static_cast<float> (std::exp (-kBodyDecay));
+
+    const bool hasTail = cur.tailLevel > 0.0 && cur.tailDecaySec > 0.0;
+    tailInc[lane] = toPhaseUnits (cur.bodyEndHz * phaseScale);
+    tailEnv[lane] = hasTail ? static_cast<float> (tailDecay[index] * cur.tailLevel) : 0.0f;
+    tailMul[lane] = hasTail ? static_cast<float> (std::exp (-dt / cur.tailDecaySec)) : 1.0f;
+
+    if (hasTail)
+        tailDecay[index] *= std::exp (-numSamples * dt / cur.tailDecaySec);
+
+    // Click: high-passed noise for its first few milliseconds.
+    const double clickDuration = 0.003 + cur.clickLevel * 0.005;
+    const int clicks = clickTime[index] < clickDuration
+                     ? juce::jmin (numSamples, static_cast<int> (std::ceil ((clickDuration - clickTime[index]) * sampleRate)))
+                     : 0;
+
+    clickSamples[lane] = clicks;
+    clickLevel[lane] = static_cast<float> (cur.clickLevel) * kClickGain;
+    clickTime[index] += clicks * dt;
+
+    const double cutoff = juce::jlimit (100.0, 10000.0, cur.toneHz);
+    toneCoeff[lane] = static_cast<float> (std::exp (-juce::MathConstants<double>::twoPi * cutoff * dt));
+
+    // Drive, normalised so full scale stays full scale.
+    const double drive = juce::jmax (1.0, cur.driveGain);
+
+    if (drive != normDrive[index])
+    {
+        normDrive[index] = drive;
+        driveNorm[index] = static_cast<float> (1.0 / std::tanh (drive));
+    }
+
+    driveGain[lane] = static_cast<float> (drive);
+    outGain[lane] = driveNorm[index] * static_cast<float> (cur.outputGain * velocity[index]);
+    laneFadeStep[lane] = (fadingMask & laneBit (lane)) != 0 ? fadeStep : 0.0f;
+}
+
+void KickVoicePool::renderControlBlock (float* out, int numSamples) noexcept
+{
+    // The same one-pole as per-sample smoothing, stepped numSamples at once.
+    const double smoothing = 1.0 - std::exp (-static_cast<double> (numSamples) / smoothingSamples);
+
+    for (int lane = 0; lane < lanes; ++lane)
+        if ((activeMask & laneBit (lane)) != 0)
+            setupLane (lane, numSamples, smoothing);
+
+    std::fill (std::begin (quietest), std::end (quietest), kOutputLimit);
+
+    for (int first = 0; first < lanes; first += groupSize)
+    {
+        const auto groupLanes = kGroupLanes << first;
+
+        if ((activeMask & groupLanes) == 0)
+            continue;
+
+        // Only the stages some lane in the group needs this block get compiled in.
+        int stages = (fadingMask & groupLanes) != 0 ? kFadeStage : 0;
+
+        for (int lane = first; lane < first + groupSize; ++lane)
+        {
+            stages |= clickSamples[lane] > 0 ? kClickStage : 0;
+            stages |= tailEnv[lane] > 0.0f ? kTailStage : 0;
+        }
+
+        (this->*groupRenderers[stages]) (first, out, numSamples);
+    }
+
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        if ((activeMask & laneBit (lane)) == 0)
+            continue;
+
+        const auto index = static_cast<size_t> (lane);
+        const auto& cur = current[index];
+        time[index] += numSamples / sampleRate;
+
+        if ((fadingMask & laneBit (lane)) != 0)
+        {
+            if (fade[lane] <= 0.0f)
+            {
+                activeMask &= ~laneBit (lane);
+                fadingMask &= ~laneBit (lane);
+                silenceLane (lane);
+            }
+        }
+        else if (time[index] > cur.bodyTimeSec + (cur.tailDecaySec * 2.5)
+                 && quietest[lane] <= kSilence * static_cast<float> (velocity[index]))
+        {
+            // The body settles on a floor rather than decaying away, so a finished voice
+            // is one that has touched silence; it fades from there rather than stopping
+            // wherever the block happens to end. Silence is relative to the hit's velocity,
+            // so a hit lasts as long however hard it is played.
+            fadingMask |= laneBit (lane);
+        }
+    }
+}
+
+const KickVoicePool::GroupRenderer KickVoicePool::groupRenderers[] = {
+    &KickVoicePool::renderGroup<false, false, false>,
+    &KickVoicePool::renderGroup<true,  false, false>,
+    &KickVoicePool::renderGroup<false, true,  false>,
+    &KickVoicePool::renderGroup<true,  true,  false>,
+    &KickVoicePool::renderGroup<false, false, true>,
+    &KickVoicePool::renderGroup<true,  false, true>,
+    &KickVoicePool::renderGroup<false, true,  true>,
+    &KickVoicePool::renderGroup<true,  true,  true>
+};
+
+template <bool withClick, bool withTail, bool withFade>
+void KickVoicePool::renderGroup (int firstLane, float* out, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        alignas (16) float y[groupSize];
+
+        // One pass over the group's lanes per sample. Every operation is 32 bits wide and
+        // the conditionals are selects, so this loop is one SIMD operation per line.
+        for (int k = 0; k < groupSize; ++k)
+        {
+            const int lane = firstLane + k;
+
+            bodyPhase[lane] += bodyInc[lane];
+            bodyInc[lane] += bodyStep[lane];
+
+            float x = fastmath::sinCycles (toCycles (bodyPhase[lane])) * bodyEnv[lane];
+            bodyEnv[lane] = juce::jmax (bodyEnv[lane] * bodyMul[lane], bodyFloor[lane]);
+
+            if constexpr (withTail)
+            {
+                tailPhase[lane] += tailInc[lane];
+                x += fastmath::sinCycles (toCycles (tailPhase[lane])) * tailEnv[lane];
+                tailEnv[lane] *= tailMul[lane];
+            }
+
+            if constexpr (withClick)
+            {
+                auto s = noiseState[lane];
+                s ^= s << 13;
+                s ^= s >> 17;
+                s ^= s << 5;
+                noiseState[lane] = s;
+
+                const float noise = static_cast<float> (static_cast<std::int32_t> (s >> 8)) * (1.0f / 8388608.0f) - 1.0f;
+                clickLP[lane] += kClickFilter * (noise - clickLP[lane]);
+                const float level = clickLevel[lane];
+                x += (noise - clickLP[lane]) * (i < clickSamples[lane] ? level : 0.0f);
+            }
+
+            toneState[lane] = toneCoeff[lane] * toneState[lane] + (1.0f - toneCoeff[lane]) * x;
+
+            const float driven = fastmath::tanh (toneState[lane] * driveGain[lane]) * outGain[lane];
+            y[k] = juce::jmin (kOutputLimit, juce::jmax (-kOutputLimit, driven));
+
+            if constexpr (withFade)
+            {
+                y[k] *= fade[lane];
+                fade[lane] = juce::jmax (0.0f, fade[lane] - laneFadeStep[lane]);
+            }
+
+            quietest[lane] = juce::jmin (quietest[lane], std::abs (y[k]));
+        }
+
+        static_assert (groupSize == 4);
+        out[i] += (y[0] + y[1]) + (y[2] + y[3]);
+    }
+}
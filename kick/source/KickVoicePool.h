@@ -0,0 +1,131 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cstdint>
+
+struct KickParams
+{
+    double clickLevel = 0.3;
+    double bodyStartHz = 120.0;
+    double bodyEndHz = 50.0;
+    double bodyTimeSec = 0.06;
+    double bodyCurve = 0.0;
+    double toneHz = 1500.0;
+    double driveGain = juce::Decibels::decibelsToGain (6.0);
+    double tailLevel = 0.5;
+    double tailDecaySec = 0.18;
+    double outputGain = juce::Decibels::decibelsToGain (0.0);
+};
+
+// A fixed pool of kicks, each a noise click, a swept sine body and a sine tail through a
+// one-pole tone filter and tanh drive, so a roll or flam lets earlier tails ring on.
+//
+// The voices are the lanes of one structure-of-arrays state: every per-voice quantity is
+// a lanes-wide array, and the inner loop runs each sample across a group of groupSize
+// lanes at once - one SSE register of floats - so overlapping kicks cost about what one
+// does. Groups with nothing sounding are skipped, and hits fill the lowest free lane, so
+// the second group only runs in dense rolls.
+//
+// Rendering goes a control block of up to controlBlock samples at a time. Everything that
+// only changes slowly - parameter smoothing, the body's sweep position, the filter and
+// decay coefficients, the drive normalisation - is worked out per lane once per control
+// block; inside it the body pitch is interpolated linearly, the envelopes are running
+// multipliers restarted from exact values each block, the sines are polynomials
+// (fastmath::sinCycles) and the click noise is a xorshift generator per lane, reseeded on
+// every hit. Phases are 32-bit fixed-point accumulators, which wrap by themselves and
+// resolve pitch to about 1e-5 Hz, so the whole per-sample state is 32 bits wide and
+// vectorises as one.
+//
+// A hit goes to a free lane. When it takes the last one, the oldest voice still sounding
+// starts a short fade, so the next hit finds a lane free without cutting anything off.
+class KickVoicePool
+{
+public:
+    static constexpr int lanes = 8;
+    static constexpr int groupSize = 4;
+    static constexpr int controlBlock = 32;
+
+    void prepare (double newSampleRate);
+    void reset();
+
+    // Applies to every voice, except that each keeps the body pitch it was triggered with.
+    void setTargetParameters (const KickParams& newTarget);
+    void trigger (const KickParams& params, double velocity);
+
+    // Adds numSamples of all sounding voices to out.
+    void renderBlock (float* out, int numSamples) noexcept;
+
+    bool isActive() const noexcept { return activeMask != 0; }
+
+    // Whether the output limiter can act on a hit with these parameters. When it cannot,
+    // the hit's output scales with its velocity, up to float rounding.
+    static bool mayClip (const KickParams& params, double velocity) noexcept;
+
+private:
+    void renderControlBlock (float* out, int numSamples) noexcept;
+
+    // The per-sample loop for one group, with the click, tail and fade stages compiled in
+    // or out. renderControlBlock() picks one from groupRenderers per group and block.
+    template <bool withClick, bool withTail, bool withFade>
+    void renderGroup (int firstLane, float* out, int numSamples) noexcept;
+
+    using GroupRenderer = void (KickVoicePool::*) (int, float*, int) noexcept;
+    static const GroupRenderer groupRenderers[8];
+
+    void setupLane (int lane, int numSamples, double smoothing) noexcept;
+    void silenceLane (int lane) noexcept;
+    int findLaneToSteal() const noexcept;
+
+    static double getBodyHz (const KickParams& params, double atTime) noexcept;
+    static double applyCurve (double t, double curve);
+
+    double sampleRate = 44100.0;
+    double smoothingSamples = 882.0;
+    double phaseScale = 0.0;   // cycles per sample to phase units
+    float fadeStep = 1.0f;
+
+    std::array<KickParams, lanes> target;
+    std::array<KickParams, lanes> current;
+    std::array<double, lanes> velocity {};
+    std::array<std::uint64_t, lanes> startedAt {};
+    std::uint64_t triggerCount = 0;
+    std::uint32_t activeMask = 0;
+    std::uint32_t fadingMask = 0;
+
+    // Per lane, kept exactly and advanced once per control block.
+    std::array<double, lanes> time {};
+    std::array<double, lanes> clickTime {};
+    std::array<double, lanes> tailDecay {};
+
+    // Per lane, updated every sample.
+    alignas (32) std::uint32_t bodyPhase[lanes] {};
+    alignas (32) std::uint32_t bodyInc[lanes] {};
+    alignas (32) std::uint32_t tailPhase[lanes] {};
+    alignas (32) std::uint32_t noiseState[lanes] {};
+    alignas (32) float bodyEnv[lanes] {};
+    alignas (32) float tailEnv[lanes] {};
+    alignas (32) float toneState[lanes] {};
+    alignas (32) float clickLP[lanes] {};
+    alignas (32) float fade[lanes] {};
+
+    // Per lane, set once per control block.
+    alignas (32) std::uint32_t bodyStep[lanes] {};   // two's complement, the sweep falls
+    alignas (32) std::uint32_t tailInc[lanes] {};
+    alignas (32) float bodyMul[lanes] {};
+    alignas (32) float bodyFloor[lanes] {};
+    alignas (32) float tailMul[lanes] {};
+    alignas (32) float clickLevel[lanes] {};
+    alignas (32) int clickSamples[lanes] {};
+    alignas (32) float toneCoeff[lanes] {};
+    alignas (32) float driveGain[lanes] {};
+    alignas (32) float outGain[lanes] {};
+    alignas (32) float laneFadeStep[lanes] {};
+
+    // Per lane, the quietest output over the current control block.
+    alignas (32) float quietest[lanes] {};
+
+    // tanh (drive) per lane, kept until the drive changes.
+    std::array<double, lanes> normDrive {};
+    std::array<float, lanes> driveNorm {};
+};
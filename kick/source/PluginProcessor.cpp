@@ -24,6 +24,9 @@ namespace
     };
 
     static_assert (std::size (parameterIds) == TriBaseKickAudioProcessor::parameterCount, "Parameter count mismatch");
+
+    // Past the voices' 20 ms smoothing, so a cached hit sounds like the live one would.
+    constexpr double kSettleSec = 0.25;
 }
 
 TriBaseKickAudioProcessor::TriBaseKickAudioProcessor()
@@ -86,11 +89,15 @@ juce::AudioProcessorValueTreeState::ParameterLayout TriBaseKickAudioProcessor::c
     return { params.begin(), params.end() };
 }
 
-void TriBaseKickAudioProcessor::prepareToPlay (double sampleRate, int)
+void TriBaseKickAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     juce::ScopedNoDenormals noDenormals;
-    voice.prepare (sampleRate);
-    voice.setTargetParameters (makeTargetParams());
+    voices.prepare (sampleRate);
+    renderBuffer.assign (static_cast<size_t> (juce::jmax (1, samplesPerBlock)), 0.0f);
+    voices.setTargetParameters (makeTargetParams());
+    renderCache.prepare (sampleRate);
+    settledSamples = 0;
+    settleThreshold = static_cast<int> (kSettleSec * sampleRate);
     outputPeak.store (0.0f);
     lastNoteNumber.store (-1);
     uiNote.store (-1);
@@ -103,6 +110,7 @@ void TriBaseKickAudioProcessor::prepareToPlay (double sampleRate, int)
 
 void TriBaseKickAudioProcessor::releaseResources()
 {
+    renderCache.release();
     scopeFifo.reset();
 }
 
@@ -142,7 +150,7 @@ void TriBaseKickAudioProcessor::setStateInformation (const void* data, int sizeI
         state.replaceState (juce::ValueTree::fromXml (*xml));
 }
 
-TriBaseKickAudioProcessor::KickParams TriBaseKickAudioProcessor::makeTargetParams() const
+KickParams TriBaseKickAudioProcessor::makeTargetParams() const
 {
     KickParams params;
     params.clickLevel   = rawParams[clickLevel]->load();
@@ -163,137 +171,6 @@ float TriBaseKickAudioProcessor::getAndResetPeak()
     return outputPeak.exchange (0.0f);
 }
 
-void TriBaseKickAudioProcessor::KickVoice::prepare (double newSampleRate)
-{
-    sampleRate = juce::jmax (1.0, newSampleRate);
-    const double smoothingTime = 0.02; // 20 ms
-    smoothingAlpha = 1.0 - std::exp (-1.0 / (smoothingTime * sampleRate));
-    active = false;
-    toneState = 0.0;
-    clickLP = 0.0;
-}
-
-void TriBaseKickAudioProcessor::KickVoice::setTargetParameters (const KickParams& newTarget)
-{
-    target = newTarget;
-}
-
-void TriBaseKickAudioProcessor::KickVoice::trigger (const KickParams& params, double vel)
-{
-    target = params;
-    current = params;
-
-    velocity = juce::jlimit (0.0, 2.0, vel);
-    time = 0.0;
-    bodyPhase = 0.0;
-    tailPhase = 0.0;
-    tailEnv = params.tailLevel;
-    clickTime = 0.0;
-    toneState = 0.0;
-    clickLP = 0.0;
-    active = true;
-}
-
-double TriBaseKickAudioProcessor::KickVoice::applyCurve (double t, double curve)
-{
-    t = juce::jlimit (0.0, 1.0, t);
-    if (curve < 0.0)
-    {
-        const double k = 1.0 + (-curve * 4.0);
-        return 1.0 - std::pow (1.0 - t, k);
-    }
-
-    if (curve > 0.0)
-    {
-        const double k = 1.0 + (curve * 4.0);
-        return std::pow (t, k);
-    }
-
-    return t;
-}
-
-double TriBaseKickAudioProcessor::KickVoice::renderSample()
-{
-    if (! active)
-        return 0.0;
-
-    const double dt = 1.0 / sampleRate;
-
-    const auto smooth = [this] (double& value, double targetValue) noexcept
-    {
-        value += smoothingAlpha * (targetValue - value);
-    };
-
-    smooth (current.clickLevel, target.clickLevel);
-    smooth (current.bodyStartHz, target.bodyStartHz);
-    smooth (current.bodyEndHz, target.bodyEndHz);
-    smooth (current.bodyTimeSec, target.bodyTimeSec);
-    smooth (current.bodyCurve, target.bodyCurve);
-    smooth (current.toneHz, target.toneHz);
-    smooth (current.driveGain, target.driveGain);
-    smooth (current.tailLevel, target.tailLevel);
-    smooth (current.tailDecaySec, target.tailDecaySec);
-    smooth (current.outputGain, target.outputGain);
-
-    double sample = 0.0;
-
-    const double clickDuration = 0.003 + current.clickLevel * 0.005;
-
-    if (clickTime < clickDuration)
-    {
-        const double noise = (random.nextDouble() * 2.0) - 1.0;
-        clickLP += 0.15 * (noise - clickLP);
-        const double hp = noise - clickLP;
-        sample += hp * current.clickLevel * 0.6;
-        clickTime += dt;
-    }
-
-    if (current.bodyTimeSec > 0.0)
-    {
-        const double prog = juce::jlimit (0.0, 1.0, time / current.bodyTimeSec);
-        const double shaped = applyCurve (prog, current.bodyCurve);
-        const double freq = juce::jlimit (20.0, 4000.0, juce::jmap (shaped, 0.0, 1.0, current.bodyStartHz, current.bodyEndHz));
-        bodyPhase += juce::MathConstants<double>::twoPi * freq * dt;
-        if (bodyPhase >= juce::MathConstants<double>::twoPi)
-            bodyPhase -= juce::MathConstants<double>::twoPi;
-
-        const double env = std::exp (-prog * 5.0);
-        sample += std::sin (bodyPhase) * env;
-    }
-
-    if (current.tailLevel > 0.0 && current.tailDecaySec > 0.0)
-    {
-        tailPhase += juce::MathConstants<double>::twoPi * current.bodyEndHz * dt;
-        if (tailPhase >= juce::MathConstants<double>::twoPi)
-            tailPhase -= juce::MathConstants<double>::twoPi;
-
-        const double tailCoeff = std::exp (-dt / current.tailDecaySec);
-        sample += std::sin (tailPhase) * tailEnv * current.tailLevel;
-        tailEnv *= tailCoeff;
-    }
-
-    const double cutoff = juce::jlimit (100.0, 10000.0, current.toneHz);
-    const double toneCoeff = std::exp (-juce::MathConstants<double>::twoPi * cutoff * dt);
-    toneState = toneCoeff * toneState + (1.0 - toneCoeff) * sample;
-
-    const double driveGain = juce::jmax (1.0, current.driveGain);
-    const double driven = std::tanh (toneState * driveGain);
-    const double norm = std::tanh (driveGain);
-    const double processed = norm > 0.0 ? driven / norm : driven;
-
-    double out = processed * current.outputGain * velocity;
-    out = juce::jlimit (-1.2, 1.2, out);
-
-    time += dt;
-
-    if (time > current.bodyTimeSec + (current.tailDecaySec * 2.5) && std::abs (out) < 1.0e-4)
-        active = false;
-
-    return out;
-}
-
-
-
 template <typename FloatType>
 void TriBaseKickAudioProcessor::processBlockInternal (juce::AudioBuffer<FloatType>& buffer, juce::MidiBuffer& midiMessages)
 {
@@ -313,6 +190,20 @@ void TriBaseKickAudioProcessor::processBlockInternal (juce::AudioBuffer<FloatTyp
     auto baseParams = makeTargetParams();
     auto currentParams = baseParams;
 
+    // Hits only come from the render cache once every knob has held still for a while;
+    // while anything moves they are synthesised live and follow it.
+    bool moved = false;
+
+    for (size_t i = 0; i < rawParams.size(); ++i)
+    {
+        const float value = rawParams[i]->load();
+        moved = moved || value != settledValues[i];
+        settledValues[i] = value;
+    }
+
+    settledSamples = moved ? 0 : juce::jmin (settleThreshold, settledSamples + numSamples);
+    const bool settled = settledSamples >= settleThreshold;
+
     const auto applyPitchFromNote = [&] (int noteNumber, KickParams& params) -> double
     {
         double endHz = params.bodyEndHz;
@@ -332,49 +223,74 @@ void TriBaseKickAudioProcessor::processBlockInternal (juce::AudioBuffer<FloatTyp
 
     const int previousNote = lastNoteNumber.load (std::memory_order_relaxed);
     double displayedEndHz = applyPitchFromNote (previousNote, currentParams);
-    voice.setTargetParameters (currentParams);
+    voices.setTargetParameters (currentParams);
+
+    float blockPeak = 0.0f;
+
+    auto* firstChannel = buffer.getWritePointer (0);
+
+    // The voices render in float; a block larger than announced is rendered in pieces.
+    const int chunkSize = static_cast<int> (renderBuffer.size());
+    int renderedUpTo = 0;
+
+    // Rendering stops at each note-on so the hit starts on its own sample.
+    const auto renderUpTo = [&] (int end)
+    {
+        for (int start = renderedUpTo; start < end && (voices.isActive() || renderCache.isActive()); start += chunkSize)
+        {
+            const int chunk = juce::jmin (chunkSize, end - start);
+            float* rendered = renderBuffer.data();
+
+            juce::FloatVectorOperations::clear (rendered, chunk);
+            voices.renderBlock (rendered, chunk);
+            renderCache.renderBlock (rendered, chunk);
+
+            const auto range = juce::FloatVectorOperations::findMinAndMax (rendered, chunk);
+            blockPeak = juce::jmax (blockPeak, -range.getStart(), range.getEnd());
+
+            for (int i = 0; i < chunk; ++i)
+                firstChannel[start + i] = static_cast<FloatType> (rendered[i]);
+        }
+
+        renderedUpTo = end;
+    };
 
     for (const auto metadata : midiMessages)
     {
         const auto& message = metadata.getMessage();
         if (message.isNoteOn())
         {
+            renderUpTo (juce::jlimit (renderedUpTo, numSamples, metadata.samplePosition));
+
             const int noteNumber = message.getNoteNumber();
             lastNoteNumber.store (noteNumber, std::memory_order_relaxed);
 
             auto triggeredParams = makeTargetParams();
             displayedEndHz = applyPitchFromNote (noteNumber, triggeredParams);
-            voice.setTargetParameters (triggeredParams);
+            voices.setTargetParameters (triggeredParams);
 
             const double velNorm = juce::jlimit (0.0, 1.0, static_cast<double> (message.getFloatVelocity()));
             double velocityScale = 1.0 + (velNorm - 1.0) * velToLevelVal;
             velocityScale = juce::jlimit (0.0, 1.0, velocityScale);
 
-            voice.trigger (triggeredParams, velocityScale);
-            currentParams = triggeredParams;
+            const auto key = KickRenderCache::makeKey (triggeredParams);
+            const bool cacheable = settled && KickRenderCache::canCache (triggeredParams);
+
+            if (! (cacheable && renderCache.trigger (key, velocityScale)))
+            {
+                voices.trigger (triggeredParams, velocityScale);
+
+                if (cacheable)
+                    renderCache.request (triggeredParams, key);
+            }
 
             uiNote.store (noteNumber, std::memory_order_relaxed);
             uiNoteHz.store (displayedEndHz, std::memory_order_relaxed);
         }
     }
 
+    renderUpTo (numSamples);
     midiMessages.clear();
-    voice.setTargetParameters (currentParams);
-
-    float blockPeak = 0.0f;
-
-    auto* firstChannel = buffer.getWritePointer (0);
-
-    for (int sample = 0; sample < numSamples; ++sample)
-    {
-        const double value = voice.renderSample();
-        const FloatType outSample = static_cast<FloatType> (value);
-
-        firstChannel[sample] = outSample;
-
-        const float absValue = static_cast<float> (std::abs (value));
-        blockPeak = juce::jmax (blockPeak, absValue);
-    }
 
     if (auto* fifo = scopeFifo.get())
     {
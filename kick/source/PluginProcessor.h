@@ -1,6 +1,9 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <vector>
+#include "KickRenderCache.h"
+#include "KickVoicePool.h"
 
 class TriBaseKickAudioProcessor : public juce::AudioProcessor
 {
@@ -80,52 +83,16 @@ private:
 
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
-    struct KickParams
-    {
-        double clickLevel = 0.3;
-        double bodyStartHz = 120.0;
-        double bodyEndHz = 50.0;
-        double bodyTimeSec = 0.06;
-        double bodyCurve = 0.0;
-        double toneHz = 1500.0;
-        double driveGain = juce::Decibels::decibelsToGain (6.0);
-        double tailLevel = 0.5;
-        double tailDecaySec = 0.18;
-        double outputGain = juce::Decibels::decibelsToGain (0.0);
-    };
-
     KickParams makeTargetParams() const;
 
-    struct KickVoice
-    {
-        void prepare (double newSampleRate);
-        void setTargetParameters (const KickParams& newTarget);
-        void trigger (const KickParams& params, double velocity);
-        double renderSample();
-        bool isActive() const { return active; }
-
-    private:
-        double sampleRate = 44100.0;
-        double smoothingAlpha = 0.0;
-
-        KickParams target;
-        KickParams current;
-
-        double velocity = 0.0;
-        double time = 0.0;
-        double bodyPhase = 0.0;
-        double tailPhase = 0.0;
-        double tailEnv = 0.0;
-        double clickTime = 0.0;
-        double toneState = 0.0;
-        double clickLP = 0.0;
-        juce::Random random;
-        bool active = false;
-
-        static double applyCurve (double t, double curve);
-    };
+    KickVoicePool voices;
+    KickRenderCache renderCache;
+    std::vector<float> renderBuffer;
 
-    KickVoice voice;
+    // Raw parameter values as of the last block, and how long they have held still.
+    std::array<float, paramCount> settledValues {};
+    int settledSamples = 0;
+    int settleThreshold = 0;
 
     std::array<std::atomic<float>*, paramCount> rawParams {};
 
@@ -0,0 +1,168 @@
+#include "Crossover.h"
+
+namespace
+{
+constexpr float kMinFrequencyHz = 20.0f;
+}
+
+template <typename FloatType>
+void Crossover<FloatType>::prepare (double newSampleRate, int numChannels)
+{
+    sampleRate = juce::jmax (1.0, newSampleRate);
+    pairs.assign (static_cast<size_t> ((juce::jmax (0, numChannels) + lanes - 1) / lanes), PairState {});
+
+    updateCoefficients();
+}
+
+template <typename FloatType>
+void Crossover<FloatType>::reset()
+{
+    std::fill (pairs.begin(), pairs.end(), PairState {});
+}
+
+template <typename FloatType>
+void Crossover<FloatType>::setFrequency (float hz)
+{
+    if (hz == frequency)
+        return;
+
+    frequency = hz;
+    updateCoefficients();
+}
+
+template <typename FloatType>
+void Crossover<FloatType>::updateCoefficients()
+{
+    const auto fc = static_cast<FloatType> (juce::jlimit (kMinFrequencyHz, static_cast<float> (sampleRate * 0.45), frequency));
+    const auto q = static_cast<FloatType> (1.0 / juce::MathConstants<double>::sqrt2);
+
+    const auto normalise = [] (const std::array<FloatType, 6>& c)
+    {
+        const FloatType a0 = c[3];
+        return Biquad { c[0] / a0, c[1] / a0, c[2] / a0, c[4] / a0, c[5] / a0 };
+    };
+
+    // Both Butterworth sections and the allpass share the same poles, which is what makes
+    // allpass - lowpass^2 the matching LR4 high band.
+    lowpass = normalise (juce::dsp::IIR::ArrayCoefficients<FloatType>::makeLowPass (sampleRate, fc, q));
+    allpass = normalise (juce::dsp::IIR::ArrayCoefficients<FloatType>::makeAllPass (sampleRate, fc, q));
+}
+
+template <typename FloatType>
+void Crossover<FloatType>::step (const Biquad& c, FloatType (&s)[2][lanes], const FloatType (&in)[lanes], FloatType (&out)[lanes]) noexcept
+{
+    for (int l = 0; l < lanes; ++l)
+    {
+        const FloatType y = c.b0 * in[l] + s[0][l];
+        s[0][l] = c.b1 * in[l] - c.a1 * y + s[1][l];
+        s[1][l] = c.b2 * in[l] - c.a2 * y;
+        out[l] = y;
+    }
+}
+
+template <typename FloatType>
+void Crossover<FloatType>::process (FloatType* const* channels, int numChannels, int startSample,
+                                    const FloatType* gains, int numSamples) noexcept
+{
+    const auto lp = lowpass;
+    const auto ap = allpass;
+
+    for (int first = 0, pair = 0; first < numChannels && pair < static_cast<int> (pairs.size()); first += lanes, ++pair)
+    {
+        auto& state = pairs[static_cast<size_t> (pair)];
+
+        // An odd last channel runs alone in the first lane; the spare lane sees silence.
+        FloatType* data[lanes] = { channels[first] + startSample,
+                                   first + 1 < numChannels ? channels[first + 1] + startSample : nullptr };
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            FloatType x[lanes], low[lanes], all[lanes];
+
+            for (int l = 0; l < lanes; ++l)
+                x[l] = data[l] != nullptr ? data[l][i] : FloatType();
+
+            step (lp, state.lp1, x, low);
+            step (lp, state.lp2, low, low);
+            step (ap, state.ap, x, all);
+
+            const FloatType lowGain = gains[i] - FloatType (1);
+
+            for (int l = 0; l < lanes; ++l)
+                if (data[l] != nullptr)
+                    data[l][i] = all[l] + lowGain * low[l];
+        }
+    }
+}
+
+template <typename FloatType>
+void Crossover<FloatType>::processAllpass (FloatType* const* channels, int numChannels, int startSample, int numSamples) noexcept
+{
+    const auto ap = allpass;
+
+    for (int first = 0, pair = 0; first < numChannels && pair < static_cast<int> (pairs.size()); first += lanes, ++pair)
+    {
+        auto& state = pairs[static_cast<size_t> (pair)];
+
+        FloatType* data[lanes] = { channels[first] + startSample,
+                                   first + 1 < numChannels ? channels[first + 1] + startSample : nullptr };
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            FloatType x[lanes], all[lanes];
+
+            for (int l = 0; l < lanes; ++l)
+                x[l] = data[l] != nullptr ? data[l][i] : FloatType();
+
+            step (ap, state.ap, x, all);
+
+            for (int l = 0; l < lanes; ++l)
+                if (data[l] != nullptr)
+                    data[l][i] = all[l];
+        }
+    }
+}
+
+template <typename FloatType>
+typename Crossover<FloatType>::ChannelState Crossover<FloatType>::getChannelState (int channel) const noexcept
+{
+    ChannelState state;
+    const auto pair = static_cast<size_t> (channel / lanes);
+
+    if (channel < 0 || pair >= pairs.size())
+        return state;
+
+    const auto& source = pairs[pair];
+    const int l = channel % lanes;
+
+    for (int k = 0; k < 2; ++k)
+    {
+        state.lp1[k] = source.lp1[k][l];
+        state.lp2[k] = source.lp2[k][l];
+        state.ap[k] = source.ap[k][l];
+    }
+
+    return state;
+}
+
+template <typename FloatType>
+void Crossover<FloatType>::setChannelState (int channel, const ChannelState& state) noexcept
+{
+    const auto pair = static_cast<size_t> (channel / lanes);
+
+    if (channel < 0 || pair >= pairs.size())
+        return;
+
+    auto& dest = pairs[pair];
+    const int l = channel % lanes;
+
+    for (int k = 0; k < 2; ++k)
+    {
+        dest.lp1[k][l] = state.lp1[k];
+        dest.lp2[k][l] = state.lp2[k];
+        dest.ap[k][l] = state.ap[k];
+    }
+}
+
+template class Crossover<float>;
+template class Crossover<double>;
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Linkwitz-Riley (4th order) split that applies a gain to the low band only.
+//
+// An LR4 low and high band sum to a 2nd-order allpass, so rather than running both bands
+// the output is formed as allpass (x) + (gain - 1) * lowpass (x): three biquads per
+// channel instead of four, and with gain == 1 the result is exactly the phase-coherent
+// band sum. Channels run in pairs with the two lanes side by side so each step of the
+// cascade is one two-wide operation.
+template <typename FloatType>
+class Crossover
+{
+public:
+    void prepare (double newSampleRate, int numChannels);
+    void reset();
+
+    void setFrequency (float hz);
+
+    // gains holds one low-band gain per sample, shared by every channel.
+    void process (FloatType* const* channels, int numChannels, int startSample,
+                  const FloatType* gains, int numSamples) noexcept;
+
+    // What process() does with every gain at 1, which is the allpass alone. Channels that
+    // are not ducked run through this, so they keep the ducked channels' phase.
+    void processAllpass (FloatType* const* channels, int numChannels, int startSample, int numSamples) noexcept;
+
+    // One channel's filter state, numbered as in process(), so it can follow the channel
+    // when the caller changes which channels it hands in.
+    struct ChannelState
+    {
+        FloatType lp1[2] {};
+        FloatType lp2[2] {};
+        FloatType ap[2] {};
+    };
+
+    ChannelState getChannelState (int channel) const noexcept;
+    void setChannelState (int channel, const ChannelState& state) noexcept;
+
+private:
+    static constexpr int lanes = 2;
+
+    struct Biquad
+    {
+        FloatType b0 { 1 }, b1 { 0 }, b2 { 0 }, a1 { 0 }, a2 { 0 };
+    };
+
+    // Transposed direct form II state for both lanes of one channel pair.
+    struct PairState
+    {
+        FloatType lp1[2][lanes] {};
+        FloatType lp2[2][lanes] {};
+        FloatType ap[2][lanes] {};
+    };
+
+    void updateCoefficients();
+
+    static void step (const Biquad& c, FloatType (&s)[2][lanes], const FloatType (&in)[lanes], FloatType (&out)[lanes]) noexcept;
+
+    double sampleRate { 44100.0 };
+    float frequency { 120.0f };
+
+    Biquad lowpass;
+    Biquad allpass;
+
+    std::vector<PairState> pairs;
+};
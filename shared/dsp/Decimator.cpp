@@ -0,0 +1,130 @@
+#include "Decimator.h"
+
+// Each stage only has to keep what would fold into 0..150 Hz out of its output, i.e. the
+// band within 150 Hz of its output rate. The rate after the final stage is at least
+// 8 kHz, so:
+//  - 3 taps (1, 2, 1) / 4 have a double zero at the input Nyquist: 73 dB down or more
+//    wherever the stage runs at 32 kHz or above, and 0.01 dB down at 150 Hz.
+//  - 7 taps (-1, 0, 9, 16, 9, 0, -1) / 32 have a fourth-order zero there, which keeps the
+//    last stage (16 kHz and up) more than 110 dB down.
+// The centre taps sit 1 and 3 input samples back, so stage k adds 2^k or 3 * 2^k host
+// samples of delay, 2 * factor - 1 in all.
+
+namespace
+{
+// Inputs run through the cascade at a time; the stages work in a scratch buffer half this
+// long, which stays in cache.
+constexpr int kChunkSamples = 256;
+}
+
+template <typename FloatType>
+void Decimator<FloatType>::prepare (int newFactor)
+{
+    factor = 1;
+
+    while (factor * 2 <= newFactor)
+        factor *= 2;
+
+    stages.assign (static_cast<size_t> (juce::roundToInt (std::log2 (factor))), Stage {});
+
+    if (! stages.empty())
+        stages.back().steep = true;
+
+    scratch.assign (static_cast<size_t> (kChunkSamples / 2 + 1), FloatType());
+
+    reset();
+}
+
+template <typename FloatType>
+void Decimator<FloatType>::reset()
+{
+    for (auto& stage : stages)
+    {
+        const bool steep = stage.steep;
+        stage = Stage {};
+        stage.steep = steep;
+    }
+
+    phase = 0;
+}
+
+template <typename FloatType>
+FloatType Decimator<FloatType>::Stage::processPair (FloatType oddInput, FloatType evenInput) noexcept
+{
+    FloatType y;
+
+    if (steep)
+    {
+        y = FloatType (0.5) * oddDelayed
+          + FloatType (9.0 / 32.0) * (even1 + even2)
+          - FloatType (1.0 / 32.0) * (evenInput + even3);
+
+        even3 = even2;
+        even2 = even1;
+        oddDelayed = oddInput;
+    }
+    else
+    {
+        y = FloatType (0.5) * oddInput + FloatType (0.25) * (evenInput + even1);
+    }
+
+    even1 = evenInput;
+    return y;
+}
+
+template <typename FloatType>
+int Decimator<FloatType>::Stage::process (const FloatType* input, FloatType* output, int numSamples) noexcept
+{
+    int numOut = 0;
+    int i = 0;
+
+    if (hasOdd && numSamples > 0)
+    {
+        output[numOut++] = processPair (odd, input[0]);
+        hasOdd = false;
+        i = 1;
+    }
+
+    for (; i + 1 < numSamples; i += 2)
+        output[numOut++] = processPair (input[i], input[i + 1]);
+
+    if (i < numSamples)
+    {
+        odd = input[i];
+        hasOdd = true;
+    }
+
+    return numOut;
+}
+
+template <typename FloatType>
+int Decimator<FloatType>::process (const FloatType* input, FloatType* output, int numSamples) noexcept
+{
+    if (stages.empty())
+    {
+        if (output != input)
+            std::copy (input, input + numSamples, output);
+
+        return numSamples;
+    }
+
+    // The first stage reads the input; the rest halve its output in place.
+    int numOut = 0;
+
+    for (int start = 0; start < numSamples; start += kChunkSamples)
+    {
+        int count = stages[0].process (input + start, scratch.data(), juce::jmin (kChunkSamples, numSamples - start));
+
+        for (size_t s = 1; s < stages.size(); ++s)
+            count = stages[s].process (scratch.data(), scratch.data(), count);
+
+        std::copy (scratch.data(), scratch.data() + count, output + numOut);
+        numOut += count;
+    }
+
+    phase = (phase + numSamples) & (factor - 1);
+    return numOut;
+}
+
+template class Decimator<float>;
+template class Decimator<double>;
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Power-of-two decimator for the sidechain detector: a cascade of halfband stages, each
+// halving the rate in polyphase form. The detector only listens below 150 Hz (the top of
+// the sidechain filter), so every stage has a wide transition band and a few taps do:
+// 3-tap stages while the rate is high, and a 7-tap stage for the final halving, where
+// the guard band is narrowest. Most of the work is in the first stage; the whole cascade
+// costs under two multiply-adds per input sample at any factor.
+template <typename FloatType>
+class Decimator
+{
+public:
+    // Allocates; factor is rounded down to a power of two.
+    void prepare (int newFactor);
+    void reset();
+
+    int getFactor() const noexcept { return factor; }
+
+    // Group delay of the cascade, in input samples.
+    int getLatencySamples() const noexcept { return factor > 1 ? 2 * factor - 1 : 0; }
+
+    // Inputs consumed since the last output, 0 .. factor - 1.
+    int getPhase() const noexcept { return phase; }
+
+    // Writes one output per 'factor' inputs and returns how many were written. The output
+    // may alias the input, since it never runs ahead of it.
+    int process (const FloatType* input, FloatType* output, int numSamples) noexcept;
+
+private:
+    // One halve-the-rate stage. Inputs come in (odd, even) pairs; the odd ones only meet
+    // the centre tap, the even ones the outer taps, and one output is due per pair.
+    struct Stage
+    {
+        bool steep = false;       // 7 taps instead of 3
+        bool hasOdd = false;      // an odd input is waiting for its pair
+        FloatType odd {};
+        FloatType oddDelayed {};  // the previous pair's odd input (7-tap centre)
+        FloatType even1 {};       // the last three even inputs, newest first
+        FloatType even2 {};
+        FloatType even3 {};
+
+        int process (const FloatType* input, FloatType* output, int numSamples) noexcept;
+        FloatType processPair (FloatType oddInput, FloatType evenInput) noexcept;
+    };
+
+    std::vector<Stage> stages;
+    std::vector<FloatType> scratch;
+
+    int factor { 1 };
+    int phase { 0 };
+};
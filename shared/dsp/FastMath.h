@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+// Branch-free log2/exp2 for the per-sample gain paths, and the sine and tanh the kick
+// renders with. All are plain arithmetic (selects, not branches) so loops over them
+// vectorise.
+namespace fastmath
+{
+// |error| < 3.2e-5 (about 2e-4 dB) for normal, positive inputs.
+inline float log2 (float x) noexcept
+{
+    const auto bits = std::bit_cast<std::uint32_t> (x);
+    const auto exponent = static_cast<float> (static_cast<std::int32_t> (bits >> 23) - 127);
+    const float m = std::bit_cast<float> ((bits & 0x007fffffu) | 0x3f800000u) - 1.0f;
+
+    const float p = 3.19081312e-05f
+                  + m * (1.44126742f
+                  + m * (-0.705704158f
+                  + m * (0.408721744f
+                  + m * (-0.187722635f
+                  + m * 0.0434289078f))));
+
+    return exponent + p;
+}
+
+// Relative error < 7.3e-6. Inputs are clamped to the normal float range.
+inline float exp2 (float x) noexcept
+{
+    x = x < -126.0f ? -126.0f : (x > 126.0f ? 126.0f : x);
+
+    // x + 127 is positive, so truncation is floor().
+    const auto biased = static_cast<std::int32_t> (x + 127.0f);
+    const float f = x - static_cast<float> (biased - 127);
+
+    const float p = 1.00000728f
+                  + f * (0.692931289f
+                  + f * (0.241710262f
+                  + f * (0.0516668774f
+                  + f * 0.0136765311f)));
+
+    return std::bit_cast<float> (static_cast<std::uint32_t> (biased) << 23) * p;
+}
+
+constexpr float dbPerLog2 = 6.02059991f;   // 20 * log10 (2)
+constexpr float log2PerDb = 0.166096404f;  // 1 / dbPerLog2
+
+inline float gainToDb (float gain) noexcept    { return dbPerLog2 * log2 (gain); }
+inline float dbToGain (float db) noexcept      { return exp2 (db * log2PerDb); }
+
+// sin (2 * pi * cycles) for cycles in [0, 1). Folded onto a quarter wave and evaluated
+// as an odd polynomial; |error| < 4e-6.
+inline float sinCycles (float cycles) noexcept
+{
+    // sin (2 pi c) = -sin (2 pi (c - 1/2)), then fold |q| > 1/4 back with sin (pi - x).
+    // The fold is written as arithmetic: a select between two computed values gets
+    // turned back into a branch and stops the kick's lane loop vectorising.
+    float q = cycles - 0.5f;
+    q = std::copysign (0.25f - std::abs (std::abs (q) - 0.25f), q);
+
+    const float x = 6.28318531f * q;
+    const float x2 = x * x;
+
+    return -x * (1.0f
+              + x2 * (-1.66666667e-1f
+              + x2 * (8.33333333e-3f
+              + x2 * (-1.98412698e-4f
+              + x2 * 2.75573192e-6f))));
+}
+
+// Rational approximation, |error| < 1e-4, saturating to +-1 beyond |x| = 5.
+inline float tanh (float x) noexcept
+{
+    // Clamped on the bit pattern for the same reason: a float clamp ahead of the divide
+    // is threaded into branches.
+    const auto bits = std::bit_cast<std::uint32_t> (x);
+    const auto magnitude = std::min (bits & 0x7fffffffu, std::bit_cast<std::uint32_t> (5.0f));
+    x = std::bit_cast<float> (magnitude | (bits & 0x80000000u));
+
+    const float x2 = x * x;
+    const float y = x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)))
+                  / (135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f)));
+
+    return std::min (1.0f, std::max (-1.0f, y));
+}
+} // namespace fastmath
@@ -0,0 +1,162 @@
+#include "GainComputer.h"
+#include "FastMath.h"
+
+namespace
+{
+constexpr float kFloorDb = -60.0f;
+constexpr float kMinLevel = 1.0e-6f;
+}
+
+void GainComputer::prepare (double newSampleRate)
+{
+    sampleRate = juce::jmax (1.0, newSampleRate);
+    updateCoefficients();
+    updateTable();
+    reset();
+}
+
+void GainComputer::reset()
+{
+    envDb = -96.0f;
+    grDb = 0.0f;
+}
+
+void GainComputer::setParameters (float thresholdDb, float newRatio, float newKneeDb, float newDepthDb,
+                                  float newMakeupDb, float newAttackMs, float newReleaseMs)
+{
+    const float newSlope = 1.0f - 1.0f / juce::jmax (1.0f, newRatio);
+    const float newKnee = juce::jmax (0.0f, newKneeDb);
+    const float newDepth = juce::jmax (0.0f, newDepthDb);
+
+    if (thresholdDb != threshDb || newSlope != slope || newKnee != kneeDb
+        || newDepth != depthDb || newMakeupDb != makeupDb)
+    {
+        threshDb = thresholdDb;
+        slope = newSlope;
+        kneeDb = newKnee;
+        depthDb = newDepth;
+        makeupDb = newMakeupDb;
+        makeupGain = juce::Decibels::decibelsToGain (makeupDb, -200.0f);
+        updateTable();
+    }
+
+    if (newAttackMs != attackMs || newReleaseMs != releaseMs)
+    {
+        attackMs = newAttackMs;
+        releaseMs = newReleaseMs;
+        updateCoefficients();
+    }
+}
+
+template <typename FloatType>
+bool GainComputer::processTile (const FloatType* envelope, float* gains, int numSamples) noexcept
+{
+    jassert (numSamples > 0 && numSamples <= tileSize);
+
+    alignas (32) float levelDb[tileSize];
+
+    // Detector level in dB, floored like the meters.
+    if (envelope != nullptr)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float x = juce::jlimit (kMinLevel, 1.0f, static_cast<float> (std::abs (envelope[i])));
+            levelDb[i] = juce::jmax (kFloorDb, fastmath::gainToDb (x));
+        }
+    }
+    else
+    {
+        std::fill (levelDb, levelDb + numSamples, kFloorDb);
+    }
+
+    // Attack/release follower, in place.
+    float e = envDb;
+    float tilePeakDb = kFloorDb;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float target = levelDb[i];
+        const float coeff = target > e ? attackCoeff : releaseCoeff;
+        e = target + coeff * (e - target);
+        levelDb[i] = e;
+        tilePeakDb = juce::jmax (tilePeakDb, e);
+    }
+
+    envDb = e;
+
+    // Below the knee the whole tile sits on the flat part of the curve.
+    if (tilePeakDb <= threshDb - 0.5f * kneeDb)
+    {
+        grDb = 0.0f;
+        std::fill (gains, gains + numSamples, makeupGain);
+        return true;
+    }
+
+    const float startDb = tableStartDb;
+    const float stepsPerDb = tableStepsPerDb;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float position = juce::jlimit (0.0f, static_cast<float> (tableSize), (levelDb[i] - startDb) * stepsPerDb);
+        const auto index = static_cast<int> (position);
+        const float frac = position - static_cast<float> (index);
+        gains[i] = gainTable[index] + frac * (gainTable[index + 1] - gainTable[index]);
+    }
+
+    grDb = -computeReductionDb (e);
+    return false;
+}
+
+template bool GainComputer::processTile (const float*, float*, int) noexcept;
+template bool GainComputer::processTile (const double*, float*, int) noexcept;
+
+float GainComputer::computeReductionDb (float levelDb) const noexcept
+{
+    // Quadratic across the knee, meeting the straight ratio line at threshDb + kneeDb / 2.
+    const float over = levelDb - threshDb;
+    float reduction = 0.0f;
+
+    if (2.0f * over >= kneeDb)
+        reduction = over * slope;
+    else if (2.0f * over > -kneeDb)
+        reduction = slope * juce::square (over + 0.5f * kneeDb) / (2.0f * kneeDb);
+
+    return juce::jmin (depthDb, reduction);
+}
+
+void GainComputer::updateTable()
+{
+    // Reduction starts at the bottom of the knee and stops growing once it reaches the
+    // depth limit: on the ratio line, or inside the knee when the depth is shallow.
+    const float startDb = threshDb - 0.5f * kneeDb;
+    float endDb = startDb;
+
+    if (slope > 0.0f && depthDb > 0.0f)
+        endDb = depthDb >= 0.5f * slope * kneeDb ? threshDb + depthDb / slope
+                                                 : startDb + std::sqrt (2.0f * kneeDb * depthDb / slope);
+
+    // Only follower levels between kFloorDb and 0 dB ever reach the table.
+    tableStartDb = juce::jlimit (kFloorDb, 0.0f, startDb);
+    const float spanDb = juce::jlimit (kFloorDb, 0.0f, endDb) - tableStartDb;
+    tableStepsPerDb = spanDb > 0.0f ? static_cast<float> (tableSize) / spanDb : 0.0f;
+
+    for (int i = 0; i <= tableSize; ++i)
+    {
+        const float levelDb = tableStartDb + spanDb * static_cast<float> (i) / static_cast<float> (tableSize);
+        gainTable[i] = juce::Decibels::decibelsToGain (makeupDb - computeReductionDb (levelDb), -200.0f);
+    }
+
+    gainTable[tableSize + 1] = gainTable[tableSize];
+}
+
+void GainComputer::updateCoefficients()
+{
+    const auto coeffFor = [this] (float ms)
+    {
+        const double samples = 0.001 * static_cast<double> (ms) * sampleRate;
+        return samples > 0.0 ? static_cast<float> (std::exp (-1.0 / samples)) : 0.0f;
+    };
+
+    attackCoeff = coeffFor (attackMs);
+    releaseCoeff = coeffFor (releaseMs);
+}
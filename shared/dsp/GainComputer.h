@@ -0,0 +1,68 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Turns the detector envelope into a per-sample linear gain for the Bass Manager.
+//
+// Work is done in tiles of up to tileSize samples: the level conversion is a straight-line
+// loop over the tile in the log domain (see FastMath.h) so it vectorises, and only the
+// attack/release follower after it is a scalar recurrence. Because the follower runs per
+// sample with state carried across calls, the output does not depend on how the host
+// splits its buffers.
+//
+// The threshold/ratio/knee/depth/makeup curve is a table from follower level in dB to
+// linear gain, rebuilt only when one of those settings changes and read with linear
+// interpolation, so no dB or exp work is left between the follower and the gains. The
+// table spans only the part of the curve that slopes, from where reduction starts to
+// where it reaches the depth limit; both corners land exactly on its end entries, and
+// the flat parts either side come from clamping to them.
+class GainComputer
+{
+public:
+    static constexpr int tileSize = 16;
+
+    void prepare (double newSampleRate);
+    void reset();
+
+    void setParameters (float thresholdDb, float ratio, float kneeDb, float depthDb, float makeupDb,
+                        float attackMs, float releaseMs);
+
+    // envelope may be nullptr when no sidechain is connected; that reads as silence. It
+    // may be float or double, but the curve itself is always computed in float.
+    // Returns true when every gain written is the same (nothing crossed the threshold),
+    // so callers can apply a single scalar instead of the array.
+    template <typename FloatType>
+    bool processTile (const FloatType* envelope, float* gains, int numSamples) noexcept;
+
+    float getGainReductionDb() const noexcept { return grDb; }
+
+private:
+    // Steps across the sloped part of the curve within kFloorDb to 0 dB, so at most about
+    // 0.12 dB a step, plus a guard entry so the last one still has a right-hand neighbour.
+    static constexpr int tableSize = 512;
+
+    void updateCoefficients();
+    void updateTable();
+    float computeReductionDb (float levelDb) const noexcept;
+
+    double sampleRate { 44100.0 };
+
+    float threshDb { -24.0f };
+    float slope { 0.75f };
+    float kneeDb { 0.0f };
+    float depthDb { 18.0f };
+    float makeupDb { 0.0f };
+    float makeupGain { 1.0f };
+    float attackMs { 5.0f };
+    float releaseMs { 120.0f };
+
+    float attackCoeff { 0.0f };
+    float releaseCoeff { 0.0f };
+
+    alignas (32) float gainTable[tableSize + 2] {};
+    float tableStartDb { -60.0f };
+    float tableStepsPerDb { 0.0f };
+
+    float envDb { -96.0f };
+    float grDb { 0.0f };
+};
@@ -0,0 +1,58 @@
+#include "GainTelemetry.h"
+#include "FastMath.h"
+
+namespace
+{
+constexpr float kFloorDb = -60.0f;
+constexpr float kMinLevel = 1.0e-6f;
+
+float toDb (float level) noexcept
+{
+    return juce::jmax (kFloorDb, fastmath::gainToDb (juce::jmax (kMinLevel, level)));
+}
+}
+
+void GainTelemetry::push (float scMin, float scMax, float gainMin, float gainMax, int numSamples) noexcept
+{
+    while (numSamples > 0)
+    {
+        const int n = juce::jmin (numSamples, pointSpacing - pending);
+
+        scLow = juce::jmin (scLow, scMin);
+        scHigh = juce::jmax (scHigh, scMax);
+        gainLow = juce::jmin (gainLow, gainMin);
+        gainHigh = juce::jmax (gainHigh, gainMax);
+
+        pending += n;
+        numSamples -= n;
+
+        if (pending < pointSpacing)
+            return;
+
+        const auto scope = fifo.write (1);
+
+        if (scope.blockSize1 > 0)
+            points[static_cast<size_t> (scope.startIndex1)] = { toDb (scLow), toDb (scHigh),
+                                                                juce::jmin (0.0f, toDb (gainLow)),
+                                                                juce::jmin (0.0f, toDb (gainHigh)) };
+
+        scLow = gainLow = none;
+        scHigh = gainHigh = 0.0f;
+        pending = 0;
+    }
+}
+
+int GainTelemetry::pull (Point* dest, int maxPoints) noexcept
+{
+    const auto scope = fifo.read (juce::jmin (maxPoints, fifo.getNumReady()));
+
+    std::copy_n (points.begin() + scope.startIndex1, scope.blockSize1, dest);
+    std::copy_n (points.begin() + scope.startIndex2, scope.blockSize2, dest + scope.blockSize1);
+
+    return scope.blockSize1 + scope.blockSize2;
+}
+
+void GainTelemetry::discard() noexcept
+{
+    fifo.read (fifo.getNumReady());
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <limits>
+
+// Decimated trace of the Bass Manager's sidechain level and gain reduction, handed from
+// the audio thread to the editor through a lock-free single-producer, single-consumer
+// ring (juce::AbstractFifo).
+//
+// The audio thread folds the min and max of each tile into the point being built and
+// publishes it every pointSpacing samples, so a transient shorter than the editor's frame
+// still shows at its true height. Points that find the ring full (no editor draining it)
+// are dropped.
+class GainTelemetry
+{
+public:
+    static constexpr int pointSpacing = 32;
+    static constexpr int capacity = 8192;
+
+    struct Point
+    {
+        float scMinDb, scMaxDb;
+        float grMinDb, grMaxDb;   // grMinDb is the deepest reduction
+    };
+
+    // Audio thread. Levels and gains are linear, gains without makeup; numSamples is how
+    // many samples the ranges cover and may be a tile or a whole block.
+    void push (float scMin, float scMax, float gainMin, float gainMax, int numSamples) noexcept;
+
+    // Message thread. Copies out up to maxPoints of the oldest points and returns how many.
+    int pull (Point* dest, int maxPoints) noexcept;
+
+    // Message thread. Throws away everything published so far.
+    void discard() noexcept;
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    std::array<Point, capacity> points {};
+
+    static constexpr float none = std::numeric_limits<float>::max();
+
+    // Only touched by the audio thread.
+    float scLow { none }, scHigh { 0.0f };
+    float gainLow { none }, gainHigh { 0.0f };
+    int pending { 0 };
+};
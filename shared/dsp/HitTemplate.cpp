@@ -0,0 +1,177 @@
+#include "HitTemplate.h"
+
+namespace
+{
+// Hysteresis below the onset level before another onset can fire.
+constexpr float kRearmRatio = 0.5f;
+}
+
+void HitTemplate::prepare (double newSampleRate, int maxAdvanceSamples)
+{
+    const double sr = juce::jmax (1.0, newSampleRate);
+
+    length = juce::jmax (1, static_cast<int> (std::lround (sr * (templateMs / 1000.0f))));
+    maxAdvance = juce::jmax (0, maxAdvanceSamples);
+
+    shape.assign (static_cast<size_t> (length), 1.0f);
+    take.assign (static_cast<size_t> (length + maxAdvance), 1.0f);
+    takes.assign (static_cast<size_t> (length * maxTakesAveraged), 1.0f);
+    sums.assign (static_cast<size_t> (length), 0.0f);
+
+    advance = juce::jmin (advance, maxAdvance);
+    reset();
+}
+
+void HitTemplate::reset()
+{
+    std::fill (shape.begin(), shape.end(), 1.0f);
+    std::fill (sums.begin(), sums.end(), 0.0f);
+
+    armed = true;
+    recording = false;
+    recordPos = 0;
+    playPos = length;
+    numTakes = 0;
+    nextTake = 0;
+    rebuildPos = length;
+    grDb = 0.0f;
+}
+
+void HitTemplate::setParameters (float thresholdDb, float newMakeupDb)
+{
+    onsetLevel = juce::Decibels::decibelsToGain (thresholdDb);
+    rearmLevel = onsetLevel * kRearmRatio;
+
+    if (newMakeupDb != makeupDb)
+    {
+        makeupDb = newMakeupDb;
+        makeupGain = juce::Decibels::decibelsToGain (makeupDb, -200.0f);
+    }
+}
+
+void HitTemplate::setAdvance (int samples) noexcept
+{
+    advance = juce::jlimit (0, maxAdvance, samples);
+}
+
+template <typename FloatType>
+bool HitTemplate::process (const FloatType* envelope, float* gains, int numSamples, bool flat) noexcept
+{
+    // The template is kept relative to the makeup gain, so a makeup change applies to it.
+    const float invMakeup = 1.0f / makeupGain;
+    bool played = false;
+
+    rebuildSums (numSamples);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (envelope != nullptr)
+        {
+            const auto level = static_cast<float> (std::abs (envelope[i]));
+
+            if (armed && level > onsetLevel)
+            {
+                // A hit that arrives mid-take still teaches whatever was recorded of the last one.
+                if (recording)
+                    commitTake (recordPos);
+
+                armed = false;
+                recording = true;
+                recordPos = 0;
+                playPos = 0;
+            }
+            else if (! armed && level < rearmLevel)
+            {
+                armed = true;
+            }
+        }
+
+        if (recording)
+        {
+            take[static_cast<size_t> (recordPos++)] = gains[i] * invMakeup;
+
+            if (recordPos == static_cast<int> (take.size()))
+            {
+                commitTake (recordPos);
+                recording = false;
+            }
+        }
+
+        if (playPos < length)
+        {
+            if (numTakes > 0)
+            {
+                gains[i] = juce::jmin (gains[i], shape[static_cast<size_t> (playPos)] * makeupGain);
+                played = true;
+            }
+
+            ++playPos;
+        }
+    }
+
+    if (numSamples > 0)
+        grDb = juce::Decibels::gainToDecibels (gains[numSamples - 1] * invMakeup, -96.0f);
+
+    return flat && ! played;
+}
+
+template bool HitTemplate::process (const float*, float*, int, bool) noexcept;
+template bool HitTemplate::process (const double*, float*, int, bool) noexcept;
+
+void HitTemplate::commitTake (int takeLength) noexcept
+{
+    // The take starts at the onset; skipping the advance lines it up with a delayed path.
+    const int usable = juce::jmin (length, takeLength - advance);
+
+    if (usable <= 0)
+        return;
+
+    // The newest take replaces the oldest, so the template follows a changing pattern. A
+    // take cut short by the next hit is padded with the template as it stands, so it only
+    // teaches the part it saw.
+    float* const slot = takes.data() + static_cast<size_t> (nextTake * length);
+    const float* source = take.data() + advance;
+    const bool replacing = numTakes == maxTakesAveraged;
+
+    nextTake = (nextTake + 1) % maxTakesAveraged;
+    numTakes = juce::jmin (numTakes + 1, maxTakesAveraged);
+
+    const float weight = 1.0f / static_cast<float> (numTakes);
+
+    for (int k = 0; k < length; ++k)
+    {
+        const auto index = static_cast<size_t> (k);
+        const float value = k < usable ? source[k] : shape[index];
+
+        sums[index] += value - (replacing ? slot[k] : 0.0f);
+        slot[k] = value;
+        shape[index] = sums[index] * weight;
+    }
+
+    // The running sums pick up rounding with every take, so they are summed afresh from
+    // the takes over the blocks that follow.
+    rebuildPos = 0;
+}
+
+void HitTemplate::rebuildSums (int count) noexcept
+{
+    const int end = juce::jmin (length, rebuildPos + count);
+
+    if (rebuildPos >= end)
+        return;
+
+    const float weight = 1.0f / static_cast<float> (juce::jmax (1, numTakes));
+
+    for (int k = rebuildPos; k < end; ++k)
+    {
+        float sum = 0.0f;
+
+        for (int t = 0; t < numTakes; ++t)
+            sum += takes[static_cast<size_t> (t * length + k)];
+
+        sums[static_cast<size_t> (k)] = sum;
+        shape[static_cast<size_t> (k)] = sum * weight;
+    }
+
+    rebuildPos = end;
+}
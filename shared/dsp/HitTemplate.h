@@ -0,0 +1,71 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Predictive ducking for sidechains whose hits look alike, such as a kick track.
+//
+// Each time the detector envelope crosses the threshold, the gain curve the GainComputer
+// produces over the next templateMs is recorded. The last maxTakesAveraged takes are
+// averaged into a template that is stored already advanced by the lookahead, so it opens with the reduction a delayed
+// main path would have met. On the next onset the template plays straight away and the
+// main path needs no delay. Per sample the cost is an onset compare and a table read, plus
+// one entry of the template's running sum rebuilt for a while after each take.
+class HitTemplate
+{
+public:
+    static constexpr float templateMs = 250.0f;
+    static constexpr int maxTakesAveraged = 4;
+
+    // maxAdvanceSamples bounds setAdvance(); nothing is allocated after this.
+    void prepare (double newSampleRate, int maxAdvanceSamples);
+
+    // Forgets the learned template as well as any take in progress.
+    void reset();
+
+    void setParameters (float thresholdDb, float makeupDb);
+
+    // How far ahead of the onset the template is read, normally the lookahead plus the
+    // detector's own lag.
+    void setAdvance (int samples) noexcept;
+
+    // gains holds the GainComputer's curve for the same samples and is replaced by the
+    // deeper of it and the template. envelope may be nullptr, which reads as silence.
+    // Returns true when every gain written is the same, like GainComputer::processTile().
+    template <typename FloatType>
+    bool process (const FloatType* envelope, float* gains, int numSamples, bool flat) noexcept;
+
+    bool hasTemplate() const noexcept         { return numTakes > 0; }
+    float getGainReductionDb() const noexcept { return grDb; }
+
+private:
+    void commitTake (int takeLength) noexcept;
+    void rebuildSums (int count) noexcept;
+
+    std::vector<float> shape;
+    std::vector<float> take;
+
+    // The last maxTakesAveraged takes, already advanced, length samples each, as a ring;
+    // sums is their running total and shape their mean.
+    std::vector<float> takes;
+    std::vector<float> sums;
+
+    int length { 0 };
+    int advance { 0 };
+    int maxAdvance { 0 };
+
+    float onsetLevel { 0.063f };
+    float rearmLevel { 0.032f };
+    float makeupDb { 0.0f };
+    float makeupGain { 1.0f };
+
+    bool armed { true };
+    bool recording { false };
+    int recordPos { 0 };
+    int playPos { 0 };
+    int numTakes { 0 };
+    int nextTake { 0 };
+    int rebuildPos { 0 };
+
+    float grDb { 0.0f };
+};
@@ -0,0 +1,109 @@
+#include "LookaheadDelay.h"
+
+template <typename FloatType>
+void LookaheadDelay<FloatType>::prepare (int newNumChannels, int maxDelaySamples)
+{
+    numChannels = juce::jmax (0, newNumChannels);
+    capacity = juce::jmax (1, maxDelaySamples);
+
+    storage.assign ((size_t) numChannels * (size_t) capacity, FloatType());
+    scratch.assign ((size_t) capacity, FloatType());
+    lastOut.assign ((size_t) numChannels, FloatType());
+
+    delay = juce::jmin (delay, capacity);
+    position = 0;
+}
+
+template <typename FloatType>
+void LookaheadDelay<FloatType>::reset()
+{
+    std::fill (storage.begin(), storage.end(), FloatType());
+    std::fill (lastOut.begin(), lastOut.end(), FloatType());
+    position = 0;
+}
+
+template <typename FloatType>
+void LookaheadDelay<FloatType>::setDelay (int newDelaySamples)
+{
+    const int newDelay = juce::jlimit (0, capacity, newDelaySamples);
+
+    if (newDelay == delay)
+        return;
+
+    const int kept = juce::jmin (delay, newDelay);
+    const int padding = newDelay - kept;
+    const int dropped = delay - kept;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* ring = getRing (ch);
+
+        // Oldest to newest, then keep the newest 'kept' samples at the end of the new ring.
+        std::copy (ring + position, ring + delay, scratch.data());
+        std::copy (ring, ring + position, scratch.data() + (delay - position));
+
+        std::fill (ring, ring + padding, lastOut[(size_t) ch]);
+        std::copy (scratch.data() + dropped, scratch.data() + delay, ring + padding);
+
+        // Over the whole new ring, fade from where the old delay would have read next to
+        // where the new one does.
+        if (dropped > 0)
+        {
+            const auto step = FloatType (1) / FloatType (kept + 1);
+
+            for (int i = 0; i < kept; ++i)
+                ring[i] = scratch[(size_t) i] + (ring[i] - scratch[(size_t) i]) * step * FloatType (i + 1);
+        }
+    }
+
+    delay = newDelay;
+    position = 0;
+}
+
+template <typename FloatType>
+void LookaheadDelay<FloatType>::process (FloatType* const* channels, int numChannelsToProcess, int numSamples) noexcept
+{
+    jassert (numChannelsToProcess <= numChannels);
+
+    if (numSamples <= 0)
+        return;
+
+    if (delay == 0)
+    {
+        for (int ch = 0; ch < juce::jmin (numChannelsToProcess, numChannels); ++ch)
+            lastOut[(size_t) ch] = channels[ch][numSamples - 1];
+
+        return;
+    }
+
+    int endPosition = position;
+
+    for (int ch = 0; ch < juce::jmin (numChannelsToProcess, numChannels); ++ch)
+    {
+        auto* data = channels[ch];
+        auto* ring = getRing (ch);
+        int pos = position;
+
+        // The ring slot at 'pos' holds the sample from exactly 'delay' samples ago: hand it
+        // out and store the new sample in its place.
+        for (int done = 0; done < numSamples;)
+        {
+            const int count = juce::jmin (numSamples - done, delay - pos);
+            std::swap_ranges (data + done, data + done + count, ring + pos);
+
+            done += count;
+            pos += count;
+
+            if (pos == delay)
+                pos = 0;
+        }
+
+        lastOut[(size_t) ch] = data[numSamples - 1];
+        endPosition = pos;
+    }
+
+    position = endPosition;
+}
+
+template class LookaheadDelay<float>;
+template class LookaheadDelay<double>;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Fixed multichannel delay for the lookahead path. Each channel's ring holds exactly the
+// current delay's worth of samples, so delaying a block is a swap of the block with the
+// ring, a contiguous range at a time; there is no per-sample read/write pointer work.
+template <typename FloatType>
+class LookaheadDelay
+{
+public:
+    void prepare (int newNumChannels, int maxDelaySamples);
+    void reset();
+
+    // Keeps the most recent samples across a change. Growing holds the last sample handed
+    // out until the kept history comes round; shrinking crossfades from the samples it
+    // drops into the ones it keeps. Neither leaves a step in the output, short of shrinking
+    // to no delay at all, where nothing is left to fade into.
+    void setDelay (int newDelaySamples);
+
+    int getDelay() const noexcept         { return delay; }
+    int getNumChannels() const noexcept   { return numChannels; }
+
+    void process (FloatType* const* channels, int numChannelsToProcess, int numSamples) noexcept;
+
+private:
+    FloatType* getRing (int channel) noexcept { return storage.data() + (size_t) channel * (size_t) capacity; }
+
+    std::vector<FloatType> storage;
+    std::vector<FloatType> scratch;
+    std::vector<FloatType> lastOut;
+
+    int numChannels { 0 };
+    int capacity { 0 };
+    int delay { 0 };
+    int position { 0 };
+};
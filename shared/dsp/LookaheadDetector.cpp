@@ -2,64 +2,226 @@
 
 namespace
 {
-constexpr float kMaxLookaheadMs = 5.0f;
+constexpr float kMinRmsWindowMs = 1.0f;
+constexpr float kMaxRmsWindowMs = 50.0f;
 constexpr float kMinFreqHz = 10.0f;
+constexpr double kMinReducedRate = 8000.0;
+
+int msToSamples (float ms, double sampleRate)
+{
+    return static_cast<int> (std::lround (sampleRate * (ms / 1000.0f)));
 }
 
-void LookaheadDetector::prepare (double newSampleRate, int newMaxBlock)
+int getDecimationFactor (double hostRate)
 {
-    sampleRate = juce::jmax (1.0, newSampleRate);
-    maxBlock   = juce::jmax (1, newMaxBlock);
+    int factor = 1;
+
+    while (hostRate / (factor * 2) >= kMinReducedRate)
+        factor *= 2;
+
+    return factor;
+}
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::prepare (double newSampleRate, int newMaxBlock)
+{
+    hostSampleRate = juce::jmax (1.0, newSampleRate);
+    maxBlock       = juce::jmax (1, newMaxBlock);
+
+    decimator.prepare (getDecimationFactor (hostSampleRate));
+    sampleRate = multirate ? hostSampleRate / decimator.getFactor() : hostSampleRate;
 
     spec.sampleRate       = sampleRate;
     spec.maximumBlockSize = static_cast<juce::uint32> (maxBlock);
     spec.numChannels      = 1u;
 
+    if (hpCoefficients == nullptr)
+        hpCoefficients = new juce::dsp::IIR::Coefficients<FloatType>();
+
+    if (bpCoefficients == nullptr)
+        bpCoefficients = new juce::dsp::IIR::Coefficients<FloatType>();
+
+    // Assign the second-order values before preparing so each filter sizes its state for
+    // the final order here rather than on the first processed block.
+    updateFilters();
+
+    hpf1.coefficients = hpCoefficients;
+    hpf2.coefficients = hpCoefficients;
+    bpf1.coefficients = bpCoefficients;
+    bpf2.coefficients = bpCoefficients;
+
     hpf1.prepare (spec);
     hpf2.prepare (spec);
     bpf1.prepare (spec);
     bpf2.prepare (spec);
 
     resizeBuffers();
+
+    envelopeDelay.prepare (1, msToSamples (maxLookaheadMs, hostSampleRate) + getMaxLatencySamples());
+
+    // Windowed state is sized for the host rate, which covers the reduced rate too.
+    squares.assign (static_cast<size_t> (juce::nextPowerOfTwo (msToSamples (kMaxRmsWindowMs, hostSampleRate) + 1)), FloatType());
+    squaresMask = static_cast<int> (squares.size()) - 1;
+
+    peakSlots.assign (static_cast<size_t> (juce::nextPowerOfTwo (msToSamples (maxLookaheadMs, hostSampleRate) + 2)), PeakSlot {});
+    peakMask = static_cast<juce::uint32> (peakSlots.size()) - 1u;
+
     reset();
-    updateFilters();
     updateSmoothing();
+    updatePeakWindow();
+
+    rmsWindow = 0;
+    updateRmsWindow();
 }
 
-void LookaheadDetector::reset()
+template <typename FloatType>
+void LookaheadDetector<FloatType>::reset()
 {
-    envelopeState = 0.0f;
+    envelopeState = 0;
+
+    std::fill (squares.begin(), squares.end(), FloatType());
+    squaresPos = 0;
+    rmsSum = 0.0;
+
+    peakHead = peakTail = peakIndex = 0;
 
     envBuf.clear();
     scMono.clear();
 
+    decimator.reset();
+    envelopeDelay.reset();
+    reducedBuf.clear();
+    rampFrom = rampTo = 0;
+    rampPos = 0;
+
     hpf1.reset();
     hpf2.reset();
     bpf1.reset();
     bpf2.reset();
 }
 
-void LookaheadDetector::setLookaheadMs (float ms)
+template <typename FloatType>
+void LookaheadDetector<FloatType>::setLookaheadMs (float ms)
 {
-    lookaheadMs = juce::jlimit (0.0f, kMaxLookaheadMs, ms);
+    lookaheadMs = juce::jlimit (0.0f, maxLookaheadMs, ms);
     updateSmoothing();
+    updatePeakWindow();
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::setMode (Mode newMode)
+{
+    if (newMode == mode)
+        return;
+
+    mode = newMode;
+
+    // Windowed state is only advanced while its mode is active, so start it afresh.
+    std::fill (squares.begin(), squares.end(), FloatType());
+    rmsSum = 0.0;
+    peakHead = peakTail;
 }
 
-void LookaheadDetector::setModeRMS (bool rmsMode)
+template <typename FloatType>
+void LookaheadDetector<FloatType>::setRmsWindowMs (float ms)
 {
-    rms = rmsMode;
+    rmsWindowMs = juce::jlimit (kMinRmsWindowMs, kMaxRmsWindowMs, ms);
+    updateRmsWindow();
 }
 
-void LookaheadDetector::setFilter (int type, float f1, float f2)
+template <typename FloatType>
+void LookaheadDetector<FloatType>::setLink (SidechainLink newLink)
 {
-    filtType = juce::jlimit (0, 2, type);
-    fLo      = juce::jmax (0.0f, f1);
-    fHi      = juce::jmax (fLo, f2);
+    link = newLink;
+}
 
-    updateFilters();
+template <typename FloatType>
+void LookaheadDetector<FloatType>::setChannelWeights (const float* weights, int numWeights)
+{
+    channelWeights.resize (static_cast<size_t> (juce::jmax (0, numWeights)));
+
+    for (size_t ch = 0; ch < channelWeights.size(); ++ch)
+        channelWeights[ch] = static_cast<FloatType> (juce::jmax (0.0f, weights[ch]));
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::setMultirate (bool shouldDecimate)
+{
+    if (shouldDecimate == multirate)
+        return;
+
+    multirate = shouldDecimate;
+    updateRate();
 }
 
-const float* LookaheadDetector::processSidechain (const float* const* sc, int numChannels, int numSamples)
+template <typename FloatType>
+int LookaheadDetector<FloatType>::getLatencySamples() const noexcept
+{
+    return multirate ? getMaxLatencySamples() : 0;
+}
+
+template <typename FloatType>
+int LookaheadDetector<FloatType>::getMaxLatencySamples() const noexcept
+{
+    // The lowpass group delay, plus one reduced-rate period for the ramp to reach each
+    // new envelope value.
+    const int factor = decimator.getFactor();
+    return factor > 1 ? decimator.getLatencySamples() + factor : 0;
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::setEnvelopeDelay (int samples)
+{
+    envelopeDelay.setDelay (samples);
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::setFilter (int type, float f1, float f2)
+{
+    const int newType  = juce::jlimit (0, 2, type);
+    const float newLo  = juce::jmax (0.0f, f1);
+    const float newHi  = juce::jmax (newLo, f2);
+
+    const bool typeChanged = newType != filtType;
+    const bool freqChanged = newLo != fLo || newHi != fHi;
+
+    if (! typeChanged && ! freqChanged)
+        return;
+
+    filtType = newType;
+    fLo      = newLo;
+    fHi      = newHi;
+
+    // New coefficients go into the running filters with their state intact, so sweeping
+    // the corner frequencies does not restart the filters on every block.
+    if (freqChanged && hpCoefficients != nullptr)
+        updateFilters();
+
+    // A pair that was switched off has not seen audio since; clear what it remembers.
+    if (typeChanged)
+        resetActiveFilters();
+}
+
+template <typename FloatType>
+const FloatType* LookaheadDetector<FloatType>::processSidechain (const FloatType* const* sc, int numChannels,
+                                                                int startSample, int numSamples)
+{
+    prepareBlock (numSamples);
+    downmix (sc, numChannels, startSample, scMono.getWritePointer (0), numSamples);
+    return runEnvelope (true, numSamples);
+}
+
+template <typename FloatType>
+const FloatType* LookaheadDetector<FloatType>::processDetection (const FloatType* detection, int numSamples)
+{
+    prepareBlock (numSamples);
+    juce::FloatVectorOperations::copy (scMono.getWritePointer (0), detection, numSamples);
+    return runEnvelope (false, numSamples);
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::prepareBlock (int numSamples)
 {
     jassert (numSamples <= maxBlock);
 
@@ -69,95 +231,241 @@ const float* LookaheadDetector::processSidechain (const float* const* sc, int nu
     if (numSamples > envBuf.getNumSamples())
         envBuf.setSize (1, numSamples, false, false, true);
 
+    if (numSamples / decimator.getFactor() + 1 > reducedBuf.getNumSamples())
+        reducedBuf.setSize (2, numSamples / decimator.getFactor() + 1, false, false, true);
+}
+
+template <typename FloatType>
+const FloatType* LookaheadDetector<FloatType>::runEnvelope (bool applyFilters, int numSamples) noexcept
+{
     auto* mono = scMono.getWritePointer (0);
+    auto* env = envBuf.getWritePointer (0);
 
-    if (sc == nullptr || numChannels <= 0)
+    if (multirate && decimator.getFactor() > 1)
     {
-        juce::FloatVectorOperations::clear (mono, numSamples);
+        const int startPhase = decimator.getPhase();
+        auto* reduced = reducedBuf.getWritePointer (0);
+        auto* reducedEnv = reducedBuf.getWritePointer (1);
+
+        const int numReduced = decimator.process (mono, reduced, numSamples);
+
+        if (applyFilters)
+            filterInPlace (reduced, numReduced);
+
+        processEnvelope (reduced, reducedEnv, numReduced);
+        interpolate (reducedEnv, startPhase, env, numSamples);
     }
     else
     {
-        const float scale = 1.0f / juce::jmax (1, numChannels);
+        if (applyFilters)
+            filterInPlace (mono, numSamples);
 
-        for (int sample = 0; sample < numSamples; ++sample)
-        {
-            float sum = 0.0f;
+        processEnvelope (mono, env, numSamples);
+    }
 
-            for (int ch = 0; ch < numChannels; ++ch)
-                sum += sc[ch][sample];
+    envelopeDelay.process (&env, 1, numSamples);
 
-            mono[sample] = sum * scale;
-        }
-    }
+    return envBuf.getReadPointer (0);
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::filterInPlace (FloatType* samples, int numSamples) noexcept
+{
+    if (filtType == 0 || numSamples <= 0)
+        return;
+
+    juce::dsp::AudioBlock<FloatType> block (&samples, 1, static_cast<size_t> (numSamples));
+    juce::dsp::ProcessContextReplacing<FloatType> ctx (block);
 
     if (filtType == 1)
     {
-        juce::dsp::AudioBlock<float> block (scMono);
-        auto sub = block.getSubBlock (0, static_cast<size_t> (numSamples));
-        juce::dsp::ProcessContextReplacing<float> ctx (sub);
         hpf1.process (ctx);
         hpf2.process (ctx);
     }
-    else if (filtType == 2)
+    else
     {
-        juce::dsp::AudioBlock<float> block (scMono);
-        auto sub = block.getSubBlock (0, static_cast<size_t> (numSamples));
-        juce::dsp::ProcessContextReplacing<float> ctx (sub);
         bpf1.process (ctx);
         bpf2.process (ctx);
     }
+}
 
-    auto* env = envBuf.getWritePointer (0);
+template <typename FloatType>
+void LookaheadDetector<FloatType>::processEnvelope (const FloatType* input, FloatType* env, int numSamples) noexcept
+{
+    switch (mode)
+    {
+        case Mode::smoothed:   processSmoothed (input, env, numSamples); break;
+        case Mode::slidingRms: processSlidingRms (input, env, numSamples); break;
+        case Mode::peakHold:   processPeakHold (input, env, numSamples); break;
+    }
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::interpolate (const FloatType* reduced, int startPhase, FloatType* env, int numSamples) noexcept
+{
+    // Follows the decimator's phase so each new value starts its ramp on the host sample
+    // that produced it, and is reached exactly one reduced-rate period later.
+    const int factor = decimator.getFactor();
+    const auto step = static_cast<FloatType> (1) / static_cast<FloatType> (factor);
+    int phase = startPhase;
+    int next = 0;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        ++rampPos;
+        env[i] = rampFrom + (rampTo - rampFrom) * (static_cast<FloatType> (rampPos) * step);
+
+        if (++phase == factor)
+        {
+            phase = 0;
+            rampFrom = rampTo;
+            rampTo = reduced[next++];
+            rampPos = 0;
+        }
+    }
+}
 
+template <typename FloatType>
+void LookaheadDetector<FloatType>::downmix (const FloatType* const* sc, int numChannels, int startSample,
+                                            FloatType* mono, int numSamples) noexcept
+{
+    if (sc == nullptr || numChannels <= 0)
+    {
+        juce::FloatVectorOperations::clear (mono, numSamples);
+        return;
+    }
+
+    // Channels past the weight table count at unity.
+    const auto getWeight = [this] (int ch)
+    {
+        return ch < static_cast<int> (channelWeights.size()) ? channelWeights[static_cast<size_t> (ch)] : FloatType (1);
+    };
+
+    // Each pass is a single channel over the whole block, so the inner loops are plain
+    // element-wise operations regardless of how many channels the bus carries.
+    if (link == SidechainLink::max)
+    {
+        juce::FloatVectorOperations::multiply (mono, sc[0] + startSample, getWeight (0), numSamples);
+
+        for (int ch = 1; ch < numChannels; ++ch)
+        {
+            const FloatType* src = sc[ch] + startSample;
+            const FloatType weight = getWeight (ch);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const FloatType x = src[i] * weight;
+                mono[i] = std::abs (x) > std::abs (mono[i]) ? x : mono[i];
+            }
+        }
+
+        return;
+    }
+
+    FloatType totalWeight = 0;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        totalWeight += getWeight (ch);
+
+    const FloatType scale = totalWeight > FloatType() ? FloatType (1) / totalWeight : FloatType();
+
+    juce::FloatVectorOperations::multiply (mono, sc[0] + startSample, getWeight (0) * scale, numSamples);
+
+    for (int ch = 1; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::addWithMultiply (mono, sc[ch] + startSample, getWeight (ch) * scale, numSamples);
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::processSmoothed (const FloatType* mono, FloatType* env, int numSamples) noexcept
+{
     for (int i = 0; i < numSamples; ++i)
     {
-        const float x = mono[i];
-        const float magnitude = rms ? std::sqrt (x * x) : std::abs (x);
+        const FloatType magnitude = std::abs (mono[i]);
 
-        if (smoothingCoeff >= 1.0f)
+        if (smoothingCoeff >= FloatType (1))
             envelopeState = magnitude;
         else
             envelopeState += smoothingCoeff * (magnitude - envelopeState);
 
         env[i] = envelopeState;
     }
+}
 
-    return envBuf.getReadPointer (0);
+template <typename FloatType>
+void LookaheadDetector<FloatType>::processSlidingRms (const FloatType* mono, FloatType* env, int numSamples) noexcept
+{
+    const double scale = 1.0 / static_cast<double> (rmsWindow);
+    FloatType* history = squares.data();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const FloatType square = mono[i] * mono[i];
+        const int oldest = (squaresPos - rmsWindow) & squaresMask;
+
+        rmsSum += static_cast<double> (square) - static_cast<double> (history[oldest]);
+        history[squaresPos] = square;
+        squaresPos = (squaresPos + 1) & squaresMask;
+
+        env[i] = static_cast<FloatType> (juce::jmax (0.0, rmsSum * scale));
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+        env[i] = std::sqrt (env[i]);
 }
 
-void LookaheadDetector::resizeBuffers()
+template <typename FloatType>
+void LookaheadDetector<FloatType>::processPeakHold (const FloatType* mono, FloatType* env, int numSamples) noexcept
+{
+    PeakSlot* slots = peakSlots.data();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const FloatType value = std::abs (mono[i]);
+
+        // Anything not louder than the new sample can never be the maximum again.
+        while (peakTail != peakHead && slots[(peakTail - 1u) & peakMask].value <= value)
+            --peakTail;
+
+        slots[peakTail & peakMask] = { peakIndex, value };
+        ++peakTail;
+
+        while (peakIndex - slots[peakHead & peakMask].index >= peakWindow)
+            ++peakHead;
+
+        env[i] = slots[peakHead & peakMask].value;
+        ++peakIndex;
+    }
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::resizeBuffers()
 {
     envBuf.setSize (1, maxBlock, false, false, true);
     scMono.setSize (1, maxBlock, false, false, true);
+    reducedBuf.setSize (2, maxBlock / decimator.getFactor() + 1, false, false, true);
 }
 
-void LookaheadDetector::updateFilters()
+template <typename FloatType>
+void LookaheadDetector<FloatType>::updateRate()
 {
-    const float nyquist = static_cast<float> (sampleRate * 0.5);
+    sampleRate = multirate ? hostSampleRate / decimator.getFactor() : hostSampleRate;
+    spec.sampleRate = sampleRate;
 
-    auto resetIfOff = [this]()
-    {
-        hpf1.reset();
-        hpf2.reset();
-        bpf1.reset();
-        bpf2.reset();
-    };
+    if (hpCoefficients != nullptr)
+        updateFilters();
 
-    if (filtType == 0)
-    {
-        resetIfOff();
-        return;
-    }
+    updateSmoothing();
+    updatePeakWindow();
+    updateRmsWindow();
 
-    if (filtType == 1)
-    {
-        const float freq = juce::jlimit (kMinFreqHz, nyquist, fLo);
-        hpf1.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass (sampleRate, freq);
-        hpf2.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass (sampleRate, freq);
-        hpf1.reset();
-        hpf2.reset();
-        return;
-    }
+    // Everything held so far was recorded at the other rate.
+    reset();
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::updateFilters()
+{
+    const float nyquist = static_cast<float> (sampleRate * 0.5);
 
     const float low  = juce::jlimit (kMinFreqHz, nyquist, fLo);
     const float high = juce::jlimit (low + 1.0f, nyquist, fHi);
@@ -165,23 +473,72 @@ void LookaheadDetector::updateFilters()
     const float bandwidth = juce::jmax (1.0f, high - low);
     const float q = juce::jlimit (0.1f, 20.0f, centre / bandwidth);
 
-    bpf1.coefficients = juce::dsp::IIR::Coefficients<float>::makeBandPass (sampleRate, centre, q);
-    bpf2.coefficients = juce::dsp::IIR::Coefficients<float>::makeBandPass (sampleRate, centre, q);
-    bpf1.reset();
-    bpf2.reset();
+    // Both sets are kept current so switching type only needs a state reset.
+    *hpCoefficients = juce::dsp::IIR::ArrayCoefficients<FloatType>::makeHighPass (sampleRate, static_cast<FloatType> (low));
+    *bpCoefficients = juce::dsp::IIR::ArrayCoefficients<FloatType>::makeBandPass (sampleRate, static_cast<FloatType> (centre), static_cast<FloatType> (q));
 }
 
-void LookaheadDetector::updateSmoothing()
+template <typename FloatType>
+void LookaheadDetector<FloatType>::resetActiveFilters()
 {
-    const float clampedMs = juce::jlimit (0.0f, kMaxLookaheadMs, lookaheadMs);
+    if (filtType == 1)
+    {
+        hpf1.reset();
+        hpf2.reset();
+    }
+    else if (filtType == 2)
+    {
+        bpf1.reset();
+        bpf2.reset();
+    }
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::updateSmoothing()
+{
+    const float clampedMs = juce::jlimit (0.0f, maxLookaheadMs, lookaheadMs);
 
     if (clampedMs <= 0.0f)
     {
-        smoothingCoeff = 1.0f;
+        smoothingCoeff = 1;
         return;
     }
 
     const double tauSeconds = static_cast<double> (clampedMs) * 0.001;
     const double alpha = 1.0 - std::exp (-1.0 / (tauSeconds * sampleRate));
-    smoothingCoeff = static_cast<float> (juce::jlimit (0.0, 1.0, alpha));
+    smoothingCoeff = static_cast<FloatType> (juce::jlimit (0.0, 1.0, alpha));
+}
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::updateRmsWindow()
+{
+    if (squares.empty())
+        return;
+
+    const int newWindow = juce::jlimit (1, squaresMask + 1, msToSamples (rmsWindowMs, sampleRate));
+
+    if (newWindow == rmsWindow)
+        return;
+
+    rmsWindow = newWindow;
+
+    // The history already holds the samples the new window covers; re-sum them once.
+    rmsSum = 0.0;
+    for (int i = 1; i <= rmsWindow; ++i)
+        rmsSum += static_cast<double> (squares[static_cast<size_t> ((squaresPos - i) & squaresMask)]);
 }
+
+template <typename FloatType>
+void LookaheadDetector<FloatType>::updatePeakWindow()
+{
+    if (peakSlots.empty())
+        return;
+
+    // The held maximum spans the sample leaving the delay line now and the lookahead
+    // samples behind it, so gain reduction is in place before a transient reaches the output.
+    const auto lookaheadSamples = static_cast<juce::uint32> (juce::jmax (0, msToSamples (lookaheadMs, sampleRate)));
+    peakWindow = juce::jmin (peakMask, lookaheadSamples + 1u);
+}
+
+template class LookaheadDetector<float>;
+template class LookaheadDetector<double>;
@@ -1,43 +1,153 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <vector>
+#include "Decimator.h"
+#include "LookaheadDelay.h"
 
+enum class DetectorMode
+{
+    smoothed,     // |x| through a one-pole smoother tied to the lookahead time
+    slidingRms,   // true RMS over the last rmsWindowMs
+    peakHold      // maximum |x| over the lookahead window
+};
+
+// How the sidechain channels are combined before filtering.
+enum class SidechainLink
+{
+    sum,   // weighted average of all channels
+    max    // the loudest weighted channel at each sample, sign kept so the filters see a waveform
+};
+
+// Instantiated for float and double so each processing precision runs natively.
+template <typename FloatType>
 class LookaheadDetector
 {
 public:
+    using Mode = DetectorMode;
+
+    static constexpr float maxLookaheadMs = 5.0f;
+
     void prepare (double newSampleRate, int newMaxBlock);
     void reset();
 
     void setLookaheadMs (float ms);
-    void setModeRMS (bool rmsMode);
+    void setMode (Mode newMode);
+    void setRmsWindowMs (float ms);
     void setFilter (int type, float f1, float f2);
+    void setLink (SidechainLink newLink);
+
+    // Runs the filters and envelope at a reduced rate (a power-of-two fraction of the host
+    // rate, no lower than 8 kHz), then interpolates the envelope back up. The envelope
+    // then lags the sidechain by getLatencySamples(), which the audio path has to add.
+    void setMultirate (bool shouldDecimate);
+    int getLatencySamples() const noexcept;
+    int getMaxLatencySamples() const noexcept;
+
+    // Holds the envelope back by a further number of host-rate samples, up to the longest
+    // lookahead plus getMaxLatencySamples(). When the audio delay is fixed, this is what
+    // sets the effective lookahead.
+    void setEnvelopeDelay (int samples);
 
-    const float* processSidechain (const float* const* sc, int numChannels, int numSamples);
+    // Relative weight per sidechain channel; channels beyond the list count as 1.
+    // Allocates, so call it from prepareToPlay or the message thread.
+    void setChannelWeights (const float* weights, int numWeights);
+
+    // Reads numSamples from startSample of each sidechain channel. The envelope only
+    // depends on the samples fed in, not on how they are split between calls, so callers
+    // can run it a short tile at a time and keep every buffer it touches in cache.
+    const FloatType* processSidechain (const FloatType* const* sc, int numChannels, int startSample, int numSamples);
+
+    // Runs the envelope (and multirate path) on a detection signal that has already been
+    // mixed and filtered elsewhere, such as SidechainBank's merged level. The filters and
+    // link set here are not used.
+    const FloatType* processDetection (const FloatType* detection, int numSamples);
+
+    // The mono mix processSidechain() starts from, with the channel weights and link set
+    // here, for callers that filter and level it elsewhere.
+    void downmix (const FloatType* const* sc, int numChannels, int startSample, FloatType* mono, int numSamples) noexcept;
 
 private:
     void resizeBuffers();
+    void prepareBlock (int numSamples);
+    const FloatType* runEnvelope (bool applyFilters, int numSamples) noexcept;
     void updateFilters();
     void updateSmoothing();
+    void resetActiveFilters();
+    void updateRmsWindow();
+    void updatePeakWindow();
+    void updateRate();
+    void filterInPlace (FloatType* samples, int numSamples) noexcept;
+    void processEnvelope (const FloatType* input, FloatType* env, int numSamples) noexcept;
+    void interpolate (const FloatType* reduced, int startPhase, FloatType* env, int numSamples) noexcept;
 
-    double sampleRate { 44100.0 };
+    void processSmoothed (const FloatType* mono, FloatType* env, int numSamples) noexcept;
+    void processSlidingRms (const FloatType* mono, FloatType* env, int numSamples) noexcept;
+    void processPeakHold (const FloatType* mono, FloatType* env, int numSamples) noexcept;
+
+    double hostSampleRate { 44100.0 };
+    double sampleRate { 44100.0 };  // the rate the filters and envelope run at
     int maxBlock { 512 };
 
-    bool rms { true };
+    Mode mode { Mode::smoothed };
+    SidechainLink link { SidechainLink::sum };
+    std::vector<FloatType> channelWeights;
     int filtType { 0 };
     float lookaheadMs { 2.0f };
+    float rmsWindowMs { 10.0f };
     float fLo { 30.0f };
     float fHi { 120.0f };
 
-    float smoothingCoeff { 1.0f };
-    float envelopeState { 0.0f };
+    FloatType smoothingCoeff { 1 };
+    FloatType envelopeState { 0 };
+
+    // Sliding RMS: a history of squared samples and the running sum of the newest
+    // rmsWindow of them. The sum is kept in double so adding and dropping the same
+    // values does not drift.
+    std::vector<FloatType> squares;
+    int squaresMask { 0 };
+    int squaresPos { 0 };
+    int rmsWindow { 1 };
+    double rmsSum { 0.0 };
+
+    // Peak hold: a monotonic deque of (sample index, |x|) with decreasing values, so
+    // the front is always the maximum of the last peakWindow samples.
+    struct PeakSlot
+    {
+        juce::uint32 index;
+        FloatType value;
+    };
+
+    std::vector<PeakSlot> peakSlots;
+    juce::uint32 peakMask { 0 };
+    juce::uint32 peakHead { 0 };
+    juce::uint32 peakTail { 0 };
+    juce::uint32 peakIndex { 0 };
+    juce::uint32 peakWindow { 1 };
+
+    juce::AudioBuffer<FloatType> envBuf;
+    juce::AudioBuffer<FloatType> scMono;
+
+    // Multirate: decimated sidechain (channel 0) and its envelope (channel 1), plus the
+    // linear ramp that carries the envelope back to the host rate.
+    bool multirate { false };
+    Decimator<FloatType> decimator;
+    juce::AudioBuffer<FloatType> reducedBuf;
+    FloatType rampFrom { 0 };
+    FloatType rampTo { 0 };
+    int rampPos { 0 };
+
+    LookaheadDelay<FloatType> envelopeDelay;
 
-    juce::AudioBuffer<float> envBuf;
-    juce::AudioBuffer<float> scMono;
+    juce::dsp::IIR::Filter<FloatType> hpf1;
+    juce::dsp::IIR::Filter<FloatType> hpf2;
+    juce::dsp::IIR::Filter<FloatType> bpf1;
+    juce::dsp::IIR::Filter<FloatType> bpf2;
 
-    juce::dsp::IIR::Filter<float> hpf1;
-    juce::dsp::IIR::Filter<float> hpf2;
-    juce::dsp::IIR::Filter<float> bpf1;
-    juce::dsp::IIR::Filter<float> bpf2;
+    // Allocated once in prepare() and shared by each cascaded pair; updateFilters()
+    // overwrites the values in place so a change never allocates or resets filter state.
+    typename juce::dsp::IIR::Coefficients<FloatType>::Ptr hpCoefficients;
+    typename juce::dsp::IIR::Coefficients<FloatType>::Ptr bpCoefficients;
 
     juce::dsp::ProcessSpec spec { 44100.0, static_cast<juce::uint32> (512), 1u };
 };
@@ -0,0 +1,113 @@
+#include "MidiDuck.h"
+#include "FastMath.h"
+
+namespace
+{
+constexpr float kSilentDb = 1.0e-3f;
+}
+
+MidiDuck::MidiDuck()
+{
+    const auto end = static_cast<float> (2 * segmentSize);
+    const double tail = std::exp (-static_cast<double> (releaseSpan));
+
+    for (int i = 0; i <= segmentSize; ++i)
+    {
+        const double u = static_cast<double> (i) / segmentSize;
+
+        // Raised-cosine rise, then an exponential fall rescaled to land exactly on zero.
+        const double rise = std::sin (juce::MathConstants<double>::halfPi * u);
+        shape[static_cast<size_t> (i)] = static_cast<float> (rise * rise);
+        shape[static_cast<size_t> (segmentSize + i)] = static_cast<float> ((std::exp (-releaseSpan * u) - tail) / (1.0 - tail));
+    }
+
+    position = end;
+}
+
+void MidiDuck::prepare (double newSampleRate)
+{
+    sampleRate = juce::jmax (1.0, newSampleRate);
+    updateSteps();
+    reset();
+}
+
+void MidiDuck::reset()
+{
+    position = static_cast<float> (2 * segmentSize);
+    hitDb = 0.0f;
+    carriedDb = 0.0f;
+    grDb = 0.0f;
+}
+
+void MidiDuck::setParameters (float newDepthDb, float newMakeupDb, float newAttackMs, float newReleaseMs)
+{
+    depthDb = juce::jmax (0.0f, newDepthDb);
+
+    if (newMakeupDb != makeupDb)
+    {
+        makeupDb = newMakeupDb;
+        makeupGain = juce::Decibels::decibelsToGain (makeupDb, -200.0f);
+    }
+
+    if (newAttackMs != attackMs || newReleaseMs != releaseMs)
+    {
+        attackMs = newAttackMs;
+        releaseMs = newReleaseMs;
+        updateSteps();
+    }
+}
+
+void MidiDuck::trigger (float velocity) noexcept
+{
+    // Hand the current reduction over to the carried release before restarting the shape.
+    carriedDb = -grDb;
+    hitDb = depthDb * juce::jlimit (0.0f, 1.0f, velocity);
+    position = 0.0f;
+}
+
+bool MidiDuck::process (float* gains, int numSamples) noexcept
+{
+    const auto end = static_cast<float> (2 * segmentSize);
+    const auto attackEnd = static_cast<float> (segmentSize);
+
+    if (position >= end && carriedDb < kSilentDb)
+    {
+        carriedDb = 0.0f;
+        grDb = 0.0f;
+        std::fill (gains, gains + numSamples, makeupGain);
+        return true;
+    }
+
+    float reduction = 0.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float hit = 0.0f;
+
+        if (position < end)
+        {
+            const auto index = static_cast<int> (position);
+            const float frac = position - static_cast<float> (index);
+            hit = hitDb * (shape[static_cast<size_t> (index)] + frac * (shape[static_cast<size_t> (index) + 1] - shape[static_cast<size_t> (index)]));
+            position = juce::jmin (end, position + (position < attackEnd ? attackStep : releaseStep));
+        }
+
+        carriedDb *= carriedCoeff;
+        reduction = juce::jmax (hit, carriedDb);
+        gains[i] = fastmath::dbToGain (makeupDb - reduction);
+    }
+
+    grDb = -reduction;
+    return false;
+}
+
+void MidiDuck::updateSteps()
+{
+    const auto samplesFor = [this] (float ms) { return juce::jmax (1.0, 0.001 * static_cast<double> (ms) * sampleRate); };
+
+    attackStep = static_cast<float> (segmentSize / samplesFor (attackMs));
+    releaseStep = static_cast<float> (segmentSize / samplesFor (releaseMs * releaseSpan));
+
+    // The carried part of an interrupted hit falls with the release's own time constant.
+    carriedCoeff = static_cast<float> (std::exp (-1.0 / samplesFor (releaseMs)));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+// Duck envelope started by MIDI note-ons instead of a detector, for zero-latency use.
+//
+// Each hit plays a fixed shape: a smooth rise to full depth over the attack time, then an
+// exponential release that reaches zero after releaseMs * releaseSpan. The shape is a
+// table built once; the attack and release times only set how fast it is read, so a
+// parameter change costs nothing and each sample is a table read plus one exp2.
+class MidiDuck
+{
+public:
+    MidiDuck();
+
+    void prepare (double newSampleRate);
+    void reset();
+
+    void setParameters (float depthDb, float makeupDb, float attackMs, float releaseMs);
+
+    // Starts a new hit at the next sample processed, scaled by velocity (0..1). Whatever
+    // the previous hit still holds keeps releasing underneath it.
+    void trigger (float velocity) noexcept;
+
+    // Same contract as GainComputer::processTile(): returns true when every gain written is
+    // the makeup gain.
+    bool process (float* gains, int numSamples) noexcept;
+
+    float getGainReductionDb() const noexcept { return grDb; }
+
+    static constexpr int segmentSize = 256;
+    static constexpr float releaseSpan = 5.0f;
+
+private:
+    void updateSteps();
+
+    // [0, segmentSize] is the attack, [segmentSize, 2 * segmentSize] the release.
+    std::array<float, 2 * segmentSize + 1> shape {};
+
+    double sampleRate { 44100.0 };
+
+    float depthDb { 18.0f };
+    float makeupDb { 0.0f };
+    float makeupGain { 1.0f };
+    float attackMs { 5.0f };
+    float releaseMs { 120.0f };
+
+    float attackStep { 1.0f };
+    float releaseStep { 1.0f };
+    float carriedCoeff { 0.0f };
+
+    float position { static_cast<float> (2 * segmentSize) };
+    float hitDb { 0.0f };
+    float carriedDb { 0.0f };
+    float grDb { 0.0f };
+};
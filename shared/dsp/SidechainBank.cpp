@@ -0,0 +1,166 @@
+#include "SidechainBank.h"
+
+namespace
+{
+constexpr float kMinFreqHz = 10.0f;
+}
+
+template <typename FloatType>
+void SidechainBank<FloatType>::prepare (double newSampleRate, int newMaxBlock)
+{
+    sampleRate = juce::jmax (1.0, newSampleRate);
+    maxBlock = juce::jmax (1, newMaxBlock);
+
+    frames.assign (static_cast<size_t> (maxBlock * lanes), FloatType());
+    merged.assign (static_cast<size_t> (maxBlock), FloatType());
+
+    for (int lane = 0; lane < lanes; ++lane)
+        updateLane (lane);
+
+    reset();
+}
+
+template <typename FloatType>
+void SidechainBank<FloatType>::reset()
+{
+    std::fill (&state[0][0][0], &state[0][0][0] + 2 * 2 * lanes, FloatType());
+}
+
+template <typename FloatType>
+void SidechainBank<FloatType>::setLane (int lane, int type, float f1, float f2, float levelScale, float levelCeiling)
+{
+    jassert (lane >= 0 && lane < lanes);
+
+    scale[lane] = static_cast<FloatType> (juce::jmax (0.0f, levelScale));
+    ceiling[lane] = static_cast<FloatType> (juce::jmax (0.0f, levelCeiling));
+
+    auto& s = settings[lane];
+    const int newType = juce::jlimit (0, 2, type);
+
+    if (newType == s.type && f1 == s.f1 && f2 == s.f2)
+        return;
+
+    // Only a change of type restarts the lane; a frequency sweep keeps its state.
+    if (newType != s.type)
+        for (auto& section : state)
+            for (auto& v : section)
+                v[lane] = FloatType();
+
+    s = { newType, f1, f2 };
+    updateLane (lane);
+}
+
+template <typename FloatType>
+void SidechainBank<FloatType>::updateLane (int lane)
+{
+    const auto& s = settings[lane];
+    std::array<FloatType, 6> c { 1, 0, 0, 1, 0, 0 };
+
+    // Same corner handling as LookaheadDetector::updateFilters().
+    const float nyquist = static_cast<float> (sampleRate * 0.5);
+    const float low  = juce::jlimit (kMinFreqHz, nyquist, s.f1);
+    const float high = juce::jlimit (low + 1.0f, nyquist, s.f2);
+
+    if (s.type == 1)
+    {
+        c = juce::dsp::IIR::ArrayCoefficients<FloatType>::makeHighPass (sampleRate, static_cast<FloatType> (low));
+    }
+    else if (s.type == 2)
+    {
+        const float centre = std::sqrt (low * high);
+        const float q = juce::jlimit (0.1f, 20.0f, centre / juce::jmax (1.0f, high - low));
+        c = juce::dsp::IIR::ArrayCoefficients<FloatType>::makeBandPass (sampleRate, static_cast<FloatType> (centre), static_cast<FloatType> (q));
+    }
+
+    const FloatType a0 = c[3];
+    filter.b0[lane] = c[0] / a0;
+    filter.b1[lane] = c[1] / a0;
+    filter.b2[lane] = c[2] / a0;
+    filter.a1[lane] = c[4] / a0;
+    filter.a2[lane] = c[5] / a0;
+}
+
+template <typename FloatType>
+void SidechainBank<FloatType>::loadLane (int lane, const FloatType* const* channels, int numChannels, int numSamples) noexcept
+{
+    jassert (lane >= 0 && lane < lanes);
+
+    // The caller splits longer host blocks, so this never reallocates.
+    jassert (numSamples <= maxBlock);
+    numSamples = juce::jmin (numSamples, maxBlock);
+
+    FloatType* dest = frames.data() + lane;
+
+    if (channels == nullptr || numChannels <= 0)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            dest[i * lanes] = FloatType();
+
+        return;
+    }
+
+    const FloatType gain = FloatType (1) / static_cast<FloatType> (numChannels);
+
+    for (int i = 0; i < numSamples; ++i)
+        dest[i * lanes] = channels[0][i];
+
+    for (int ch = 1; ch < numChannels; ++ch)
+    {
+        const FloatType* src = channels[ch];
+
+        for (int i = 0; i < numSamples; ++i)
+            dest[i * lanes] += src[i];
+    }
+
+    if (numChannels > 1)
+        for (int i = 0; i < numSamples; ++i)
+            dest[i * lanes] *= gain;
+}
+
+template <typename FloatType>
+const FloatType* SidechainBank<FloatType>::process (int numSamples) noexcept
+{
+    static_assert (lanes == 4, "the combiner below is written out for four lanes");
+    jassert (numSamples <= maxBlock);
+    numSamples = juce::jmin (numSamples, maxBlock);
+
+    const auto c = filter;
+    const bool useMax = combine == SidechainCombine::max;
+
+    // Transposed direct form II across all lanes; each loop over l is one vector operation.
+    const auto step = [&c] (FloatType (&s)[2][lanes], FloatType (&x)[lanes])
+    {
+        for (int l = 0; l < lanes; ++l)
+        {
+            const FloatType y = c.b0[l] * x[l] + s[0][l];
+            s[0][l] = c.b1[l] * x[l] - c.a1[l] * y + s[1][l];
+            s[1][l] = c.b2[l] * x[l] - c.a2[l] * y;
+            x[l] = y;
+        }
+    };
+
+    const FloatType* frame = frames.data();
+    FloatType* out = merged.data();
+
+    for (int i = 0; i < numSamples; ++i, frame += lanes)
+    {
+        alignas (32) FloatType x[lanes];
+
+        for (int l = 0; l < lanes; ++l)
+            x[l] = frame[l];
+
+        step (state[0], x);
+        step (state[1], x);
+
+        for (int l = 0; l < lanes; ++l)
+            x[l] = juce::jmin (std::abs (x[l]) * scale[l], ceiling[l]);
+
+        out[i] = useMax ? juce::jmax (juce::jmax (x[0], x[1]), juce::jmax (x[2], x[3]))
+                        : (x[0] + x[1]) + (x[2] + x[3]);
+    }
+
+    return out;
+}
+
+template class SidechainBank<float>;
+template class SidechainBank<double>;
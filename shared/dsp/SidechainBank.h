@@ -0,0 +1,73 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+// How the sidechain inputs are merged into the one level the envelope stage follows.
+enum class SidechainCombine
+{
+    max,   // the loudest input at each sample
+    sum    // the inputs' levels added together
+};
+
+// Front end for up to four sidechain inputs, each with its own filter, sensitivity and
+// depth limit, merged into a single detection signal for LookaheadDetector.
+//
+// The inputs are the lanes of one structure-of-arrays state: every coefficient and filter
+// state is a lanes-wide array and each step of the cascade runs across all inputs at once,
+// so four inputs cost about what one does. Inputs are downmixed into sample-major frames
+// of lanes values before the filters run.
+template <typename FloatType>
+class SidechainBank
+{
+public:
+    static constexpr int lanes = 4;
+
+    void prepare (double newSampleRate, int newMaxBlock);
+    void reset();
+
+    // type is 0 (off), 1 (HPF) or 2 (BP), as for LookaheadDetector::setFilter(). The lane's
+    // rectified level is multiplied by levelScale, then limited to levelCeiling.
+    void setLane (int lane, int type, float f1, float f2, float levelScale, float levelCeiling);
+    void setCombine (SidechainCombine newCombine) noexcept { combine = newCombine; }
+
+    // Averages a bus into its lane for the next process(). A lane without a bus this block
+    // should be loaded with numChannels == 0, which reads as silence. At most the prepared
+    // block size.
+    void loadLane (int lane, const FloatType* const* channels, int numChannels, int numSamples) noexcept;
+
+    // Returns numSamples of the merged, rectified level.
+    const FloatType* process (int numSamples) noexcept;
+
+private:
+    // One lanes-wide biquad: coefficient c[l] belongs to input l.
+    struct LaneBiquad
+    {
+        FloatType b0[lanes], b1[lanes], b2[lanes], a1[lanes], a2[lanes];
+    };
+
+    struct LaneSettings
+    {
+        int type { -1 };
+        float f1 { 0.0f };
+        float f2 { 0.0f };
+    };
+
+    void updateLane (int lane);
+
+    double sampleRate { 44100.0 };
+    int maxBlock { 512 };
+
+    SidechainCombine combine { SidechainCombine::max };
+    LaneSettings settings[lanes];
+
+    // Both sections of the cascade share coefficients, as the single-input filters do.
+    alignas (32) LaneBiquad filter {};
+    alignas (32) FloatType state[2][2][lanes] {};
+    alignas (32) FloatType scale[lanes] {};
+    alignas (32) FloatType ceiling[lanes] {};
+
+    std::vector<FloatType> frames;
+    std::vector<FloatType> merged;
+};
@@ -0,0 +1,297 @@
+#include "SpectralDucker.h"
+#include "FastMath.h"
+
+namespace
+{
+constexpr int kHopDivisor = 8;
+constexpr size_t kAlignFloats = 32 / sizeof (float);
+constexpr float kFloorDb = -60.0f;
+constexpr float kMinLevel = 1.0e-6f;
+
+// About 47 Hz per bin at any of the usual rates.
+int getFftOrder (double sampleRate)
+{
+    if (sampleRate <= 50000.0)
+        return 10;
+
+    return sampleRate <= 100000.0 ? 11 : 12;
+}
+
+size_t roundUpToAlignment (size_t numFloats)
+{
+    return (numFloats + kAlignFloats - 1) & ~(kAlignFloats - 1);
+}
+}
+
+template <typename FloatType>
+void SpectralDucker<FloatType>::prepare (double newSampleRate, int maxChannels, int maxBlock)
+{
+    sampleRate = juce::jmax (1.0, newSampleRate);
+
+    const int order = getFftOrder (sampleRate);
+    fft = std::make_unique<juce::dsp::FFT> (order);
+    fftSize = 1 << order;
+    hop = fftSize / kHopDivisor;
+    span = 2 * hop;
+    numBins = fftSize / 2 + 1;
+    numChannelsPrepared = juce::jmax (0, maxChannels);
+
+    const auto n = static_cast<size_t> (fftSize);
+    const auto tail = static_cast<size_t> (span);
+    const size_t sizes[] = { n,                      // window
+                             tail,                   // synthesis
+                             2 * n,                  // fftData (complex interleaved)
+                             n,                      // scInput
+                             static_cast<size_t> (numBins),
+                             static_cast<size_t> (numBins),
+                             n * static_cast<size_t> (numChannelsPrepared),
+                             tail * static_cast<size_t> (numChannelsPrepared) };
+
+    size_t total = kAlignFloats;
+
+    for (const auto size : sizes)
+        total += roundUpToAlignment (size);
+
+    storage.assign (total, 0.0f);
+
+    // Skip to the first aligned float, then lay the regions out back to back.
+    const auto address = reinterpret_cast<std::uintptr_t> (storage.data());
+    float* next = storage.data() + ((32 - address % 32) % 32) / sizeof (float);
+    float** regions[] = { &window, &synthesis, &fftData, &scInput, &binEnvDb, &reduction, &inputs, &overlaps };
+
+    for (size_t i = 0; i < std::size (regions); ++i)
+    {
+        *regions[i] = next;
+        next += roundUpToAlignment (sizes[i]);
+    }
+
+    // Asymmetric windows (Mauler and Martin): the analysis window rises over the whole frame
+    // less a hop and falls over the last hop, and the synthesis window only covers the last
+    // two hops. Their product there is a periodic Hann two hops long, which sums to one
+    // across hops, so the output only waits for those two hops while the bins keep the
+    // whole frame's resolution.
+    const auto hann = [] (int i, int length)
+    {
+        return 0.5f - 0.5f * std::cos (juce::MathConstants<float>::twoPi * static_cast<float> (i) / static_cast<float> (length));
+    };
+
+    const int rise = fftSize - hop;
+    const int tailStart = fftSize - span;
+    float windowSum = 0.0f;
+
+    for (int i = 0; i < fftSize; ++i)
+    {
+        window[i] = i < rise ? std::sqrt (hann (i, 2 * rise)) : std::sqrt (hann (i - tailStart, span));
+        windowSum += window[i];
+    }
+
+    for (int i = 0; i < span; ++i)
+        synthesis[i] = i + tailStart < rise ? hann (i, span) / window[i + tailStart] : window[i + tailStart];
+
+    // A full-scale sine centred on a bin reads as 1.
+    magnitudeScale = 2.0f / windowSum;
+
+    residual.setSize (juce::jmax (1, numChannelsPrepared), juce::jmax (1, maxBlock));
+
+    updateCoefficients();
+    reset();
+}
+
+template <typename FloatType>
+void SpectralDucker<FloatType>::reset()
+{
+    const auto n = static_cast<size_t> (fftSize);
+
+    std::fill (scInput, scInput + n, 0.0f);
+    std::fill (inputs, inputs + n * static_cast<size_t> (numChannelsPrepared), 0.0f);
+    std::fill (overlaps, overlaps + static_cast<size_t> (span) * static_cast<size_t> (numChannelsPrepared), 0.0f);
+    std::fill (binEnvDb, binEnvDb + numBins, kFloorDb);
+
+    residual.clear();
+    fill = 0;
+    grDb = 0.0f;
+}
+
+template <typename FloatType>
+void SpectralDucker<FloatType>::remapChannels (const int* previous, int numChannels) noexcept
+{
+    numChannels = juce::jmin (numChannels, numChannelsPrepared);
+
+    const auto move = [this] (int from, int to)
+    {
+        std::copy (getInput (from), getInput (from) + fftSize, getInput (to));
+        std::copy (getOverlap (from), getOverlap (from) + span, getOverlap (to));
+    };
+
+    const auto isKept = [&] (int ch) { return previous[ch] >= 0 && previous[ch] < numChannelsPrepared; };
+
+    // Kept channels are in order, so moving the ones that go down first, lowest first,
+    // and then the ones that go up, highest first, reads every history before anything
+    // lands on it.
+    for (int ch = 0; ch < numChannels; ++ch)
+        if (isKept (ch) && previous[ch] > ch)
+            move (previous[ch], ch);
+
+    for (int ch = numChannels; --ch >= 0;)
+        if (isKept (ch) && previous[ch] < ch)
+            move (previous[ch], ch);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        if (! isKept (ch))
+        {
+            std::fill (getInput (ch), getInput (ch) + fftSize, 0.0f);
+            std::fill (getOverlap (ch), getOverlap (ch) + span, 0.0f);
+        }
+    }
+}
+
+template <typename FloatType>
+void SpectralDucker<FloatType>::setParameters (float thresholdDb, float ratio, float newDepthDb, float newAttackMs, float newReleaseMs)
+{
+    threshDb = thresholdDb;
+    slope = 1.0f - 1.0f / juce::jmax (1.0f, ratio);
+    depthDb = juce::jmax (0.0f, newDepthDb);
+
+    if (newAttackMs != attackMs || newReleaseMs != releaseMs)
+    {
+        attackMs = newAttackMs;
+        releaseMs = newReleaseMs;
+        updateCoefficients();
+    }
+}
+
+template <typename FloatType>
+void SpectralDucker<FloatType>::updateCoefficients()
+{
+    // The bin followers advance once per hop.
+    const auto coeffFor = [this] (float ms)
+    {
+        const double hops = 0.001 * static_cast<double> (ms) * sampleRate / juce::jmax (1, hop);
+        return hops > 0.0 ? static_cast<float> (std::exp (-1.0 / hops)) : 0.0f;
+    };
+
+    attackCoeff = coeffFor (attackMs);
+    releaseCoeff = coeffFor (releaseMs);
+}
+
+template <typename FloatType>
+void SpectralDucker<FloatType>::process (const FloatType* const* channels, int numChannels,
+                                         const FloatType* const* sc, int numScChannels, int numSamples) noexcept
+{
+    numChannels = juce::jmin (numChannels, numChannelsPrepared);
+
+    // The caller splits longer host blocks, so the residual is never resized here.
+    jassert (numSamples <= residual.getNumSamples());
+    numSamples = juce::jmin (numSamples, residual.getNumSamples());
+
+    const auto scGain = numScChannels > 0 ? 1.0f / static_cast<float> (numScChannels) : 0.0f;
+    const int newest = fftSize - hop;
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int n = juce::jmin (numSamples - done, hop - fill);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* in = getInput (ch) + newest + fill;
+            const float* out = getOverlap (ch) + fill;
+            FloatType* res = residual.getWritePointer (ch, done);
+
+            for (int i = 0; i < n; ++i)
+            {
+                in[i] = static_cast<float> (channels[ch][done + i]);
+                res[i] = static_cast<FloatType> (out[i]);
+            }
+        }
+
+        float* scIn = scInput + newest + fill;
+        std::fill (scIn, scIn + n, 0.0f);
+
+        for (int ch = 0; ch < numScChannels; ++ch)
+            for (int i = 0; i < n; ++i)
+                scIn[i] += static_cast<float> (sc[ch][done + i]) * scGain;
+
+        fill += n;
+        done += n;
+
+        if (fill == hop)
+        {
+            processFrame (numChannels);
+            fill = 0;
+        }
+    }
+}
+
+template <typename FloatType>
+void SpectralDucker<FloatType>::processFrame (int numChannels) noexcept
+{
+    const int keep = span - hop;
+    const int tailStart = fftSize - span;
+
+    // Sidechain spectrum, and from it the per-bin reduction.
+    juce::FloatVectorOperations::multiply (fftData, scInput, window, fftSize);
+    std::fill (fftData + fftSize, fftData + 2 * fftSize, 0.0f);
+    fft->performRealOnlyForwardTransform (fftData, true);
+
+    float deepest = 0.0f;
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        const float re = fftData[2 * k];
+        const float im = fftData[2 * k + 1];
+        const float level = juce::jmax (kMinLevel, std::sqrt (re * re + im * im) * magnitudeScale);
+        const float target = juce::jmax (kFloorDb, fastmath::gainToDb (level));
+
+        float& env = binEnvDb[k];
+        env = target + (target > env ? attackCoeff : releaseCoeff) * (env - target);
+
+        const float gr = juce::jmin (depthDb, juce::jmax (0.0f, env - threshDb) * slope);
+        reduction[k] = 1.0f - fastmath::dbToGain (-gr);
+        deepest = juce::jmax (deepest, gr);
+    }
+
+    grDb = -deepest;
+    std::copy (scInput + hop, scInput + fftSize, scInput);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        float* in = getInput (ch);
+        float* overlap = getOverlap (ch);
+
+        // The samples just handed out are done; the rest move up a hop.
+        std::copy (overlap + hop, overlap + span, overlap);
+        std::fill (overlap + keep, overlap + span, 0.0f);
+
+        if (deepest > 0.0f)
+        {
+            juce::FloatVectorOperations::multiply (fftData, in, window, fftSize);
+            std::fill (fftData + fftSize, fftData + 2 * fftSize, 0.0f);
+            fft->performRealOnlyForwardTransform (fftData, false);
+
+            // Scale both halves so the inverse sees a symmetric spectrum either way.
+            for (int k = 0; k < numBins; ++k)
+            {
+                fftData[2 * k] *= reduction[k];
+                fftData[2 * k + 1] *= reduction[k];
+            }
+
+            for (int k = numBins; k < fftSize; ++k)
+            {
+                fftData[2 * k] *= reduction[fftSize - k];
+                fftData[2 * k + 1] *= reduction[fftSize - k];
+            }
+
+            fft->performRealOnlyInverseTransform (fftData);
+
+            // Only the last two hops are synthesised; they are what the output still needs.
+            for (int i = 0; i < span; ++i)
+                overlap[i] += fftData[tailStart + i] * synthesis[i];
+        }
+
+        std::copy (in + hop, in + fftSize, in);
+    }
+}
+
+template class SpectralDucker<float>;
+template class SpectralDucker<double>;
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+// Spectral duck for the Bass Manager: each STFT bin of the main signal is reduced by the
+// amount the sidechain's level in that bin calls for, so bins the kick leaves alone keep
+// their bass.
+//
+// Rather than resynthesising the whole signal, the ducker returns the part to remove,
+// (1 - gain) * X overlap-added back to the time domain, aligned with the main signal
+// delayed by getLatencySamples(). The caller subtracts it from its own delayed copy, so
+// with no reduction the output is the input untouched, in whatever precision it runs at.
+// Frames where no bin is reduced skip the main-signal transforms entirely.
+//
+// The FFT size follows the sample rate so a bin stays about 47 Hz wide, with a hop of an
+// eighth of a frame. Only the last two hops of each frame are resynthesised, so the
+// latency is a quarter of a frame, about 5 ms at any of the usual rates, rather than the
+// whole frame. Every buffer is allocated and 32-byte aligned in prepare().
+template <typename FloatType>
+class SpectralDucker
+{
+public:
+    void prepare (double newSampleRate, int maxChannels, int maxBlock);
+    void reset();
+
+    void setParameters (float thresholdDb, float ratio, float depthDb, float attackMs, float releaseMs);
+
+    int getLatencySamples() const noexcept { return span; }
+
+    // channels are the undelayed main channels to duck, sc the sidechain bus (any number
+    // of channels, downmixed here). Up to the prepared block size and channel count.
+    void process (const FloatType* const* channels, int numChannels,
+                  const FloatType* const* sc, int numScChannels, int numSamples) noexcept;
+
+    // Moves each channel's history to where the caller now hands it in: channel i takes
+    // over what channel previous[i] held, or starts from silence when previous[i] is
+    // negative. Channels kept on must stay in the same order. The sidechain's analysis is
+    // left as it is.
+    void remapChannels (const int* previous, int numChannels) noexcept;
+
+    // What to subtract from each delayed channel over the last process() call.
+    const FloatType* getResidual (int channel) const noexcept { return residual.getReadPointer (channel); }
+
+    // Deepest reduction in any bin over the last frame.
+    float getGainReductionDb() const noexcept { return grDb; }
+
+private:
+    void processFrame (int numChannels) noexcept;
+    void updateCoefficients();
+
+    float* getInput (int channel) noexcept  { return inputs + static_cast<size_t> (channel) * static_cast<size_t> (fftSize); }
+    float* getOverlap (int channel) noexcept { return overlaps + static_cast<size_t> (channel) * static_cast<size_t> (span); }
+
+    double sampleRate { 44100.0 };
+    int fftSize { 0 };
+    int hop { 0 };
+    int span { 0 };
+    int numBins { 0 };
+    int fill { 0 };
+    int numChannelsPrepared { 0 };
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+
+    // One allocation carved into the regions below, each starting on a 32-byte boundary.
+    std::vector<float> storage;
+    float* window { nullptr };
+    float* synthesis { nullptr };
+    float* fftData { nullptr };
+    float* scInput { nullptr };
+    float* binEnvDb { nullptr };
+    float* reduction { nullptr };
+    float* inputs { nullptr };
+    float* overlaps { nullptr };
+
+    juce::AudioBuffer<FloatType> residual;
+
+    float magnitudeScale { 1.0f };
+
+    float threshDb { -24.0f };
+    float slope { 0.75f };
+    float depthDb { 18.0f };
+    float attackMs { 5.0f };
+    float releaseMs { 120.0f };
+    float attackCoeff { 0.0f };
+    float releaseCoeff { 0.0f };
+
+    float grDb { 0.0f };
+};
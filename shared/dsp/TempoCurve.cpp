@@ -0,0 +1,117 @@
+#include "TempoCurve.h"
+#include "FastMath.h"
+
+namespace
+{
+// Share of the period spent falling back to full depth ahead of the beat.
+constexpr double kAttackFraction = 0.03;
+}
+
+void TempoCurve::prepare (double newSampleRate)
+{
+    sampleRate = juce::jmax (1.0, newSampleRate);
+    updateIncrement();
+    reset();
+}
+
+void TempoCurve::reset()
+{
+    phase = 0.0;
+    grDb = 0.0f;
+}
+
+void TempoCurve::setParameters (float newDepthDb, float newMakeupDb, double newPeriodBeats, float newRecovery, float newCurve)
+{
+    newDepthDb = juce::jmax (0.0f, newDepthDb);
+    newRecovery = juce::jlimit (0.01f, 1.0f, newRecovery);
+    newCurve = juce::jlimit (0.0f, 1.0f, newCurve);
+
+    if (newPeriodBeats != periodBeats)
+    {
+        periodBeats = juce::jmax (1.0e-3, newPeriodBeats);
+        updateIncrement();
+    }
+
+    if (newDepthDb == depthDb && newMakeupDb == makeupDb && newRecovery == recovery && newCurve == curve)
+        return;
+
+    depthDb = newDepthDb;
+    makeupDb = newMakeupDb;
+    recovery = newRecovery;
+    curve = newCurve;
+
+    render();
+}
+
+void TempoCurve::setTempo (double newBpm) noexcept
+{
+    if (newBpm > 0.0 && newBpm != bpm)
+    {
+        bpm = newBpm;
+        updateIncrement();
+    }
+}
+
+void TempoCurve::setPpqPosition (double ppq) noexcept
+{
+    const double periods = ppq / periodBeats;
+    phase = periods - std::floor (periods);
+}
+
+bool TempoCurve::process (float* gains, int numSamples) noexcept
+{
+    float gain = table[0];
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const double position = phase * tableSize;
+        const auto index = static_cast<int> (position);
+        const auto frac = static_cast<float> (position - index);
+
+        gain = table[static_cast<size_t> (index)] + frac * (table[static_cast<size_t> (index) + 1] - table[static_cast<size_t> (index)]);
+        gains[i] = gain;
+
+        phase += increment;
+
+        if (phase >= 1.0)
+            phase -= 1.0;
+    }
+
+    grDb = fastmath::gainToDb (gain) - makeupDb;
+
+    // No depth leaves a table of makeup gain only.
+    return depthDb <= 0.0f;
+}
+
+void TempoCurve::render()
+{
+    // The return to unity, from linear at curve = 0.5 to fast (0) or held down (1).
+    const double exponent = 0.25 * std::pow (16.0, static_cast<double> (curve));
+    const double recoveryEnd = static_cast<double> (recovery) * (1.0 - kAttackFraction);
+
+    for (int i = 0; i < tableSize; ++i)
+    {
+        const double x = static_cast<double> (i) / tableSize;
+        double amount = 0.0;
+
+        if (x >= 1.0 - kAttackFraction)
+        {
+            const double rise = std::sin (juce::MathConstants<double>::halfPi * (x - (1.0 - kAttackFraction)) / kAttackFraction);
+            amount = rise * rise;
+        }
+        else if (x < recoveryEnd)
+        {
+            amount = 1.0 - std::pow (x / recoveryEnd, exponent);
+        }
+
+        table[static_cast<size_t> (i)] = juce::Decibels::decibelsToGain (makeupDb - depthDb * static_cast<float> (amount), -200.0f);
+    }
+
+    // Guard point so the interpolation can read one past the end and wrap.
+    table[tableSize] = table[0];
+}
+
+void TempoCurve::updateIncrement() noexcept
+{
+    increment = bpm / (60.0 * sampleRate * periodBeats);
+}
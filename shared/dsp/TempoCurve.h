@@ -0,0 +1,54 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+// Beat-locked "pump" for the Bass Manager: a gain curve over one sync period, played from
+// the host's tempo and position with no detector at all.
+//
+// The curve is rendered into a table only when its shape parameters change. Each period
+// opens at full depth on the beat, recovers to nothing over the recovery fraction and
+// rises again just before the next beat. Playing it costs one interpolated table read
+// per sample.
+class TempoCurve
+{
+public:
+    static constexpr int tableSize = 1024;
+
+    void prepare (double newSampleRate);
+    void reset();
+
+    // periodBeats is the sync period in quarter notes, recovery the fraction of it spent
+    // returning to unity (0..1) and curve the shape of that return, 0.5 being linear.
+    void setParameters (float depthDb, float makeupDb, double periodBeats, float recovery, float curve);
+
+    void setTempo (double bpm) noexcept;
+
+    // Locks the phase to the host's position in quarter notes. Without a call the curve
+    // free-runs at the last tempo given.
+    void setPpqPosition (double ppq) noexcept;
+
+    // Same contract as GainComputer::processTile().
+    bool process (float* gains, int numSamples) noexcept;
+
+    float getGainReductionDb() const noexcept { return grDb; }
+
+private:
+    void render();
+    void updateIncrement() noexcept;
+
+    std::array<float, tableSize + 1> table {};
+
+    double sampleRate { 44100.0 };
+    double bpm { 120.0 };
+    double periodBeats { 1.0 };
+    double phase { 0.0 };
+    double increment { 0.0 };
+
+    float depthDb { -1.0f };
+    float makeupDb { 0.0f };
+    float recovery { -1.0f };
+    float curve { -1.0f };
+
+    float grDb { 0.0f };
+};
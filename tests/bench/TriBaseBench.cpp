@@ -0,0 +1,393 @@
+#include <JuceHeader.h>
+
+#include "common/AudioThreadProbe.h"
+#include "common/HeadlessHarness.h"
+#include "dsp/LookaheadDetector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+using tribase::test::ProcessorKind;
+
+const juce::Array<int> defaultBlockSizes { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+const juce::Array<double> defaultSampleRates { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+constexpr double defaultSeconds = 1.0;
+constexpr int warmupBlocks = 8;
+
+struct BenchConfig
+{
+    juce::Array<ProcessorKind> processors;
+    juce::Array<int> blockSizes;
+    juce::Array<double> sampleRates;
+    bool runDetector = true;
+    bool runFloat = true;
+    bool runDouble = true;
+    double seconds = defaultSeconds;
+    juce::File outputFile;
+};
+
+struct RunResult
+{
+    juce::int64 blocks = 0;
+    double nsPerSample = 0.0;
+    double meanNs = 0.0;
+    double p50Ns = 0.0;
+    double p99Ns = 0.0;
+    double maxNs = 0.0;
+    double realtimeLoad = 0.0;
+    tribase::test::ProbeStats probe;
+};
+
+double percentile (const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    const auto index = static_cast<size_t> (std::ceil (fraction * static_cast<double> (sorted.size()))) - 1;
+    return sorted[std::min (index, sorted.size() - 1)];
+}
+
+RunResult summarise (std::vector<double>& blockNs, double sampleRate, int blockSize)
+{
+    double totalNs = 0.0;
+    for (auto ns : blockNs)
+        totalNs += ns;
+
+    std::sort (blockNs.begin(), blockNs.end());
+
+    const double blockDurationNs = 1.0e9 * blockSize / sampleRate;
+
+    RunResult result;
+    result.blocks = static_cast<juce::int64> (blockNs.size());
+    result.meanNs = totalNs / static_cast<double> (blockNs.size());
+    result.nsPerSample = result.meanNs / blockSize;
+    result.p50Ns = percentile (blockNs, 0.50);
+    result.p99Ns = percentile (blockNs, 0.99);
+    result.maxNs = blockNs.back();
+    result.realtimeLoad = result.meanNs / blockDurationNs;
+    return result;
+}
+
+template <typename FloatType>
+RunResult runOne (ProcessorKind kind, double sampleRate, int blockSize, bool automationStorm, double seconds)
+{
+    auto processor = tribase::test::createProcessor (kind);
+    tribase::test::HeadlessSession<FloatType> session (*processor, kind, sampleRate, blockSize);
+
+    for (int i = 0; i < warmupBlocks; ++i)
+    {
+        session.prepareNextBlock (automationStorm);
+        session.process();
+    }
+
+    const auto numBlocks = juce::jmax ((juce::int64) 1, (juce::int64) std::ceil (seconds * sampleRate / blockSize));
+
+    std::vector<double> blockNs;
+    blockNs.reserve (static_cast<size_t> (numBlocks));
+
+    tribase::test::ProbeStats probeTotal;
+
+    for (juce::int64 block = 0; block < numBlocks; ++block)
+    {
+        session.prepareNextBlock (automationStorm);
+
+        tribase::test::ScopedAudioThreadProbe probe;
+        const auto start = std::chrono::steady_clock::now();
+        session.process();
+        const auto stop = std::chrono::steady_clock::now();
+        const auto stats = probe.finish();
+
+        blockNs.push_back (std::chrono::duration<double, std::nano> (stop - start).count());
+        probeTotal += stats;
+    }
+
+    auto result = summarise (blockNs, sampleRate, blockSize);
+    result.probe = probeTotal;
+    return result;
+}
+
+// The Bass Manager's sidechain detector on its own, at the host rate or multirate, so its
+// cost per second of audio can be compared across sample rates. The input is a stereo
+// 55 Hz kick every half second, through the band-pass sidechain filter.
+template <typename FloatType>
+RunResult runDetector (double sampleRate, int blockSize, bool multirate, double seconds)
+{
+    LookaheadDetector<FloatType> detector;
+    detector.setMultirate (multirate);
+    detector.prepare (sampleRate, blockSize);
+    detector.setFilter (2, 30.0f, 120.0f);
+
+    juce::AudioBuffer<FloatType> sidechain (2, blockSize);
+    const auto kickPeriod = static_cast<juce::int64> (sampleRate / 2.0);
+    juce::int64 position = 0;
+
+    const auto writeInput = [&]
+    {
+        for (int i = 0; i < blockSize; ++i)
+        {
+            const auto t = static_cast<double> ((position + i) % kickPeriod) / sampleRate;
+            const auto x = static_cast<FloatType> (std::exp (-t * 12.0) * std::sin (juce::MathConstants<double>::twoPi * 55.0 * t));
+            sidechain.setSample (0, i, x);
+            sidechain.setSample (1, i, x);
+        }
+
+        position += blockSize;
+    };
+
+    for (int i = 0; i < warmupBlocks; ++i)
+    {
+        writeInput();
+        detector.processSidechain (sidechain.getArrayOfReadPointers(), 2, 0, blockSize);
+    }
+
+    const auto numBlocks = juce::jmax ((juce::int64) 1, (juce::int64) std::ceil (seconds * sampleRate / blockSize));
+
+    std::vector<double> blockNs;
+    blockNs.reserve (static_cast<size_t> (numBlocks));
+
+    tribase::test::ProbeStats probeTotal;
+
+    for (juce::int64 block = 0; block < numBlocks; ++block)
+    {
+        writeInput();
+
+        tribase::test::ScopedAudioThreadProbe probe;
+        const auto start = std::chrono::steady_clock::now();
+        detector.processSidechain (sidechain.getArrayOfReadPointers(), 2, 0, blockSize);
+        const auto stop = std::chrono::steady_clock::now();
+        const auto stats = probe.finish();
+
+        blockNs.push_back (std::chrono::duration<double, std::nano> (stop - start).count());
+        probeTotal += stats;
+    }
+
+    auto result = summarise (blockNs, sampleRate, blockSize);
+    result.probe = probeTotal;
+    return result;
+}
+
+juce::var toVar (const RunResult& r)
+{
+    auto* blockTime = new juce::DynamicObject();
+    blockTime->setProperty ("mean", r.meanNs);
+    blockTime->setProperty ("p50", r.p50Ns);
+    blockTime->setProperty ("p99", r.p99Ns);
+    blockTime->setProperty ("max", r.maxNs);
+
+    auto* audioThread = new juce::DynamicObject();
+    audioThread->setProperty ("allocations", (juce::int64) r.probe.allocations);
+    audioThread->setProperty ("deallocations", (juce::int64) r.probe.deallocations);
+    audioThread->setProperty ("bytes", (juce::int64) r.probe.bytes);
+    audioThread->setProperty ("locks", (juce::int64) r.probe.locks);
+    audioThread->setProperty ("syscalls", (juce::int64) r.probe.syscalls);
+
+    auto* obj = new juce::DynamicObject();
+    obj->setProperty ("blocks", r.blocks);
+    obj->setProperty ("nsPerSample", r.nsPerSample);
+    obj->setProperty ("blockNs", juce::var (blockTime));
+    obj->setProperty ("realtimeLoad", r.realtimeLoad);
+    obj->setProperty ("audioThread", juce::var (audioThread));
+    return juce::var (obj);
+}
+
+template <typename Type>
+juce::Array<Type> parseList (const juce::String& text, const juce::Array<Type>& fallback)
+{
+    if (text.isEmpty())
+        return fallback;
+
+    juce::Array<Type> values;
+
+    for (auto& token : juce::StringArray::fromTokens (text, ",", {}))
+    {
+        if constexpr (std::is_same_v<Type, int>)
+            values.add (token.getIntValue());
+        else
+            values.add (token.getDoubleValue());
+    }
+
+    return values;
+}
+
+void printUsage()
+{
+    std::cout << "tribase_bench [options]\n"
+                 "  --out <file>               write JSON here instead of stdout\n"
+                 "  --seconds <s>              audio rendered per run (default 1)\n"
+                 "  --processors <a,b>         bassmanager, kick, instrument, detector (default all)\n"
+                 "  --block-sizes <n,n>        default 16..4096 in powers of two\n"
+                 "  --sample-rates <sr,sr>     default 44100..192000\n"
+                 "  --precision <float|double|both>\n";
+}
+
+bool parseConfig (const juce::ArgumentList& args, BenchConfig& config)
+{
+    if (args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return false;
+    }
+
+    const auto processors = args.getValueForOption ("--processors");
+
+    if (processors.isEmpty())
+    {
+        for (auto kind : tribase::test::getAllProcessorKinds())
+            config.processors.add (kind);
+    }
+    else
+    {
+        config.runDetector = false;
+
+        for (auto& id : juce::StringArray::fromTokens (processors, ",", {}))
+        {
+            if (id == "detector")
+            {
+                config.runDetector = true;
+                continue;
+            }
+
+            ProcessorKind kind;
+            if (! tribase::test::parseProcessorId (id, kind))
+            {
+                std::cerr << "Unknown processor: " << id << "\n";
+                return false;
+            }
+
+            config.processors.add (kind);
+        }
+    }
+
+    config.blockSizes = parseList (args.getValueForOption ("--block-sizes"), defaultBlockSizes);
+    config.sampleRates = parseList (args.getValueForOption ("--sample-rates"), defaultSampleRates);
+
+    if (const auto seconds = args.getValueForOption ("--seconds"); seconds.isNotEmpty())
+        config.seconds = juce::jmax (0.01, seconds.getDoubleValue());
+
+    const auto precision = args.getValueForOption ("--precision").toLowerCase();
+    config.runFloat = precision.isEmpty() || precision == "both" || precision == "float";
+    config.runDouble = precision.isEmpty() || precision == "both" || precision == "double";
+
+    if (const auto out = args.getValueForOption ("--out"); out.isNotEmpty())
+        config.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile (out);
+
+    return true;
+}
+
+void addResult (juce::Array<juce::var>& results, const juce::String& processor, const char* precision,
+                double sampleRate, int blockSize, const char* scenario, const RunResult& r)
+{
+    auto entry = toVar (r);
+    auto* obj = entry.getDynamicObject();
+    obj->setProperty ("processor", processor);
+    obj->setProperty ("precision", precision);
+    obj->setProperty ("sampleRate", sampleRate);
+    obj->setProperty ("blockSize", blockSize);
+    obj->setProperty ("scenario", scenario);
+    obj->setProperty ("nsPerSecondOfAudio", r.nsPerSample * sampleRate);
+    results.add (entry);
+
+    std::cerr << processor << " " << precision << " " << sampleRate << " Hz " << blockSize << " smp "
+              << scenario << ": " << juce::String (r.nsPerSample, 2) << " ns/sample, "
+              << juce::String (r.nsPerSample * sampleRate / 1000.0, 1) << " us per second of audio, p99 "
+              << juce::String (r.p99Ns / 1000.0, 2) << " us, "
+              << (juce::int64) r.probe.allocations << " allocs\n";
+}
+
+juce::var describeBuild()
+{
+    auto* build = new juce::DynamicObject();
+    build->setProperty ("juce", juce::SystemStats::getJUCEVersion());
+    build->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+    build->setProperty ("cpu", juce::SystemStats::getCpuModel());
+   #if JUCE_DEBUG
+    build->setProperty ("config", "Debug");
+   #else
+    build->setProperty ("config", "Release");
+   #endif
+    build->setProperty ("timestamp", juce::Time::getCurrentTime().toISO8601 (true));
+    return juce::var (build);
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    BenchConfig config;
+    if (! parseConfig (juce::ArgumentList (argc, argv), config))
+        return 1;
+
+    juce::Array<juce::var> results;
+
+    for (auto kind : config.processors)
+    {
+        for (auto sampleRate : config.sampleRates)
+        {
+            for (auto blockSize : config.blockSizes)
+            {
+                for (const bool automationStorm : { false, true })
+                {
+                    const auto id = tribase::test::getProcessorId (kind);
+                    const auto scenario = automationStorm ? "automation" : "steady";
+
+                    if (config.runFloat)
+                        addResult (results, id, "float", sampleRate, blockSize, scenario,
+                                   runOne<float> (kind, sampleRate, blockSize, automationStorm, config.seconds));
+
+                    if (config.runDouble)
+                        addResult (results, id, "double", sampleRate, blockSize, scenario,
+                                   runOne<double> (kind, sampleRate, blockSize, automationStorm, config.seconds));
+                }
+            }
+        }
+    }
+
+    if (config.runDetector)
+    {
+        for (auto sampleRate : config.sampleRates)
+        {
+            for (auto blockSize : config.blockSizes)
+            {
+                for (const bool multirate : { false, true })
+                {
+                    const auto scenario = multirate ? "multirate" : "full-rate";
+
+                    if (config.runFloat)
+                        addResult (results, "detector", "float", sampleRate, blockSize, scenario,
+                                   runDetector<float> (sampleRate, blockSize, multirate, config.seconds));
+
+                    if (config.runDouble)
+                        addResult (results, "detector", "double", sampleRate, blockSize, scenario,
+                                   runDetector<double> (sampleRate, blockSize, multirate, config.seconds));
+                }
+            }
+        }
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("schema", 1);
+    root->setProperty ("build", describeBuild());
+    root->setProperty ("results", results);
+
+    const auto json = juce::JSON::toString (juce::var (root));
+
+    if (config.outputFile != juce::File())
+    {
+        if (! config.outputFile.replaceWithText (json))
+        {
+            std::cerr << "Could not write " << config.outputFile.getFullPathName() << "\n";
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout << json << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,606 @@
+#include "AudioThreadProbe.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined (__APPLE__)
+ #include <malloc/malloc.h>
+ #define TRIBASE_PROBE_INTERPOSE 1
+#elif defined (__GLIBC__)
+ #define TRIBASE_PROBE_INTERPOSE 1
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void  __libc_free (void*);
+}
+#else
+ #define TRIBASE_PROBE_INTERPOSE 0
+#endif
+
+#if defined (_MSC_VER)
+ #define TRIBASE_PROBE_NOINLINE __declspec (noinline)
+#else
+ #define TRIBASE_PROBE_NOINLINE __attribute__ ((noinline))
+#endif
+
+#if TRIBASE_PROBE_INTERPOSE
+ #include <cxxabi.h>
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <semaphore.h>
+ #include <time.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+enum class Violation
+{
+    allocation,
+    deallocation,
+    lock,
+    syscall
+};
+
+// Plain TLS so that touching it from inside malloc can never allocate.
+thread_local bool probeActive = false;
+thread_local bool reporting = false;
+thread_local const char* probeContext = nullptr;
+thread_local tribase::test::ProbeStats probeStats;
+
+bool reportCallSites = false;
+
+#if TRIBASE_PROBE_INTERPOSE
+constexpr int maxFrames = 32;
+constexpr int framesToSkip = 1; // noteViolation
+constexpr int framesInSignature = 8;
+constexpr int framesToMatch = 4;
+
+std::array<std::uint64_t, 512> seenCallSites {};
+size_t numSeenCallSites = 0;
+
+struct ExpectedViolation
+{
+    const char* interceptedCall;
+    const char* caller;
+};
+
+std::array<ExpectedViolation, 16> expectedViolations {};
+size_t numExpectedViolations = 0;
+
+// Stacks already checked against the expectations, so each one is symbolised only once.
+struct ClassifiedCallSite
+{
+    std::uint64_t signature;
+    bool expected;
+};
+
+std::array<ClassifiedCallSite, 512> classifiedCallSites {};
+size_t numClassifiedCallSites = 0;
+
+const char* describe (Violation kind) noexcept
+{
+    switch (kind)
+    {
+        case Violation::allocation:   return "heap allocation";
+        case Violation::deallocation: return "heap deallocation";
+        case Violation::lock:         return "lock";
+        case Violation::syscall:      return "system call";
+    }
+
+    return "violation";
+}
+
+std::uint64_t getSignature (void* const* frames, int numFrames) noexcept
+{
+    std::uint64_t signature = 1469598103934665603ull;
+
+    for (int i = framesToSkip; i < numFrames && i < framesToSkip + framesInSignature; ++i)
+        signature = (signature ^ reinterpret_cast<std::uintptr_t> (frames[i])) * 1099511628211ull;
+
+    return signature;
+}
+
+bool isNewCallSite (void* const* frames, int numFrames) noexcept
+{
+    const auto signature = getSignature (frames, numFrames);
+
+    for (size_t i = 0; i < numSeenCallSites; ++i)
+        if (seenCallSites[i] == signature)
+            return false;
+
+    if (numSeenCallSites < seenCallSites.size())
+        seenCallSites[numSeenCallSites++] = signature;
+
+    return true;
+}
+
+bool isCalledFrom (void* const* frames, int numFrames, const char* caller) noexcept
+{
+    for (int i = framesToSkip; i < numFrames && i < framesToSkip + framesToMatch; ++i)
+    {
+        Dl_info info {};
+
+        if (dladdr (frames[i], &info) == 0 || info.dli_sname == nullptr)
+            continue;
+
+        int status = -1;
+        char* demangled = abi::__cxa_demangle (info.dli_sname, nullptr, nullptr, &status);
+        const bool matches = std::strstr (status == 0 && demangled != nullptr ? demangled : info.dli_sname, caller) != nullptr;
+        std::free (demangled);
+
+        if (matches)
+            return true;
+    }
+
+    return false;
+}
+
+bool isExpected (const char* function, void* const* frames, int numFrames) noexcept
+{
+    const auto signature = getSignature (frames, numFrames);
+
+    for (size_t i = 0; i < numClassifiedCallSites; ++i)
+        if (classifiedCallSites[i].signature == signature)
+            return classifiedCallSites[i].expected;
+
+    bool expected = false;
+
+    for (size_t i = 0; i < numExpectedViolations && ! expected; ++i)
+        expected = std::strcmp (expectedViolations[i].interceptedCall, function) == 0
+                    && isCalledFrom (frames, numFrames, expectedViolations[i].caller);
+
+    if (numClassifiedCallSites < classifiedCallSites.size())
+        classifiedCallSites[numClassifiedCallSites++] = { signature, expected };
+
+    return expected;
+}
+
+void reportCallSite (Violation kind, const char* function, void* const* frames, int numFrames) noexcept
+{
+    if (! isNewCallSite (frames, numFrames))
+        return;
+
+    std::fprintf (stderr, "\n[rtcheck] %s (%s) on the audio thread%s%s\n",
+                  describe (kind), function,
+                  probeContext != nullptr ? " during " : "",
+                  probeContext != nullptr ? probeContext : "");
+
+    for (int i = framesToSkip; i < numFrames; ++i)
+    {
+        Dl_info info {};
+
+        if (dladdr (frames[i], &info) != 0 && info.dli_sname != nullptr)
+        {
+            int status = -1;
+            char* demangled = abi::__cxa_demangle (info.dli_sname, nullptr, nullptr, &status);
+            const auto offset = static_cast<const char*> (frames[i]) - static_cast<const char*> (info.dli_saddr);
+
+            std::fprintf (stderr, "    #%-2d %s + %td\n", i - framesToSkip,
+                          status == 0 && demangled != nullptr ? demangled : info.dli_sname, offset);
+            std::free (demangled);
+        }
+        else
+        {
+            std::fprintf (stderr, "    #%-2d %p (%s)\n", i - framesToSkip, frames[i],
+                          info.dli_fname != nullptr ? info.dli_fname : "?");
+        }
+    }
+}
+#endif
+
+TRIBASE_PROBE_NOINLINE void noteViolation (Violation kind, const char* function, std::size_t bytes = 0) noexcept
+{
+    if (! probeActive || reporting)
+        return;
+
+   #if TRIBASE_PROBE_INTERPOSE
+    if (reportCallSites || numExpectedViolations > 0)
+    {
+        reporting = true;
+
+        void* frames[maxFrames];
+        const int numFrames = backtrace (frames, maxFrames);
+        const bool expected = isExpected (function, frames, numFrames);
+
+        if (reportCallSites && ! expected)
+            reportCallSite (kind, function, frames, numFrames);
+
+        reporting = false;
+
+        if (expected)
+        {
+            ++probeStats.expected;
+            return;
+        }
+    }
+   #else
+    (void) function;
+   #endif
+
+    switch (kind)
+    {
+        case Violation::allocation:   ++probeStats.allocations; probeStats.bytes += bytes; break;
+        case Violation::deallocation: ++probeStats.deallocations; break;
+        case Violation::lock:         ++probeStats.locks; break;
+        case Violation::syscall:      ++probeStats.syscalls; break;
+    }
+}
+
+//==============================================================================
+void* rawMalloc (std::size_t size) noexcept
+{
+   #if defined (__APPLE__)
+    return malloc_zone_malloc (malloc_default_zone(), size);
+   #elif defined (__GLIBC__)
+    return __libc_malloc (size);
+   #else
+    return std::malloc (size);
+   #endif
+}
+
+void* rawCalloc (std::size_t count, std::size_t size) noexcept
+{
+   #if defined (__APPLE__)
+    return malloc_zone_calloc (malloc_default_zone(), count, size);
+   #elif defined (__GLIBC__)
+    return __libc_calloc (count, size);
+   #else
+    return std::calloc (count, size);
+   #endif
+}
+
+void* rawRealloc (void* ptr, std::size_t size) noexcept
+{
+   #if defined (__APPLE__)
+    return malloc_zone_realloc (malloc_default_zone(), ptr, size);
+   #elif defined (__GLIBC__)
+    return __libc_realloc (ptr, size);
+   #else
+    return std::realloc (ptr, size);
+   #endif
+}
+
+void* rawAlignedAlloc (std::size_t alignment, std::size_t size) noexcept
+{
+   #if defined (__APPLE__)
+    return malloc_zone_memalign (malloc_default_zone(), alignment, size);
+   #elif defined (__GLIBC__)
+    return __libc_memalign (alignment, size);
+   #else
+    return std::aligned_alloc (alignment, (size + alignment - 1) / alignment * alignment);
+   #endif
+}
+
+void rawFree (void* ptr) noexcept
+{
+   #if defined (__APPLE__)
+    if (ptr != nullptr)
+        malloc_zone_free (malloc_zone_from_ptr (ptr), ptr);
+   #elif defined (__GLIBC__)
+    __libc_free (ptr);
+   #else
+    std::free (ptr);
+   #endif
+}
+
+//==============================================================================
+void* countedNew (std::size_t size)
+{
+    noteViolation (Violation::allocation, "operator new", size);
+
+    if (auto* ptr = rawMalloc (size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* countedAlignedNew (std::size_t size, std::align_val_t alignment)
+{
+    noteViolation (Violation::allocation, "operator new", size);
+
+    if (auto* ptr = rawAlignedAlloc (static_cast<std::size_t> (alignment), size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void countedDelete (void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        noteViolation (Violation::deallocation, "operator delete");
+
+    rawFree (ptr);
+}
+
+//==============================================================================
+#if TRIBASE_PROBE_INTERPOSE
+template <typename Fn>
+Fn resolveNext (const char* name) noexcept
+{
+    return reinterpret_cast<Fn> (dlsym (RTLD_NEXT, name));
+}
+
+// Everything the interposers forward to, resolved before main() so that dlsym never runs
+// inside a probe window. A call that arrives before static init resolves on demand.
+struct RealFunctions
+{
+    decltype (&::pthread_mutex_lock) mutexLock = nullptr;
+    decltype (&::pthread_mutex_trylock) mutexTryLock = nullptr;
+    decltype (&::pthread_rwlock_rdlock) rwlockRead = nullptr;
+    decltype (&::pthread_rwlock_wrlock) rwlockWrite = nullptr;
+    decltype (&::pthread_cond_wait) condWait = nullptr;
+    decltype (&::pthread_cond_timedwait) condTimedWait = nullptr;
+    decltype (&::sem_wait) semWait = nullptr;
+    decltype (&::read) read = nullptr;
+    decltype (&::write) write = nullptr;
+    decltype (&::close) close = nullptr;
+    decltype (&::nanosleep) nanosleep = nullptr;
+    decltype (&::usleep) usleep = nullptr;
+    decltype (&::sched_yield) schedYield = nullptr;
+    int (*open) (const char*, int, ...) = nullptr;
+
+    void resolveAll() noexcept
+    {
+        mutexLock     = resolveNext<decltype (mutexLock)> ("pthread_mutex_lock");
+        mutexTryLock  = resolveNext<decltype (mutexTryLock)> ("pthread_mutex_trylock");
+        rwlockRead    = resolveNext<decltype (rwlockRead)> ("pthread_rwlock_rdlock");
+        rwlockWrite   = resolveNext<decltype (rwlockWrite)> ("pthread_rwlock_wrlock");
+        condWait      = resolveNext<decltype (condWait)> ("pthread_cond_wait");
+        condTimedWait = resolveNext<decltype (condTimedWait)> ("pthread_cond_timedwait");
+        semWait       = resolveNext<decltype (semWait)> ("sem_wait");
+        read          = resolveNext<decltype (read)> ("read");
+        write         = resolveNext<decltype (write)> ("write");
+        close         = resolveNext<decltype (close)> ("close");
+        nanosleep     = resolveNext<decltype (nanosleep)> ("nanosleep");
+        usleep        = resolveNext<decltype (usleep)> ("usleep");
+        schedYield    = resolveNext<decltype (schedYield)> ("sched_yield");
+        open          = resolveNext<decltype (open)> ("open");
+    }
+};
+
+RealFunctions& getReal() noexcept
+{
+    static RealFunctions functions = []
+    {
+        RealFunctions f;
+        f.resolveAll();
+        return f;
+    }();
+
+    return functions;
+}
+
+// Touch the table (and backtrace(), which may dlopen its unwinder) at load time.
+[[maybe_unused]] const bool realFunctionsResolved = []
+{
+    void* frame = nullptr;
+    backtrace (&frame, 1);
+    return getReal().mutexLock != nullptr;
+}();
+#endif
+} // namespace
+
+//==============================================================================
+namespace tribase::test
+{
+void AudioThreadProbe::begin() noexcept
+{
+    probeStats = {};
+    probeActive = true;
+}
+
+ProbeStats AudioThreadProbe::end() noexcept
+{
+    probeActive = false;
+    return probeStats;
+}
+
+bool AudioThreadProbe::isActive() noexcept
+{
+    return probeActive;
+}
+
+void AudioThreadProbe::setReportCallSites (bool shouldReport) noexcept
+{
+    reportCallSites = shouldReport;
+}
+
+void AudioThreadProbe::setContext (const char* description) noexcept
+{
+    probeContext = description;
+}
+
+void AudioThreadProbe::expectViolation (const char* interceptedCall, const char* caller) noexcept
+{
+   #if TRIBASE_PROBE_INTERPOSE
+    if (numExpectedViolations < expectedViolations.size())
+        expectedViolations[numExpectedViolations++] = { interceptedCall, caller };
+
+    numClassifiedCallSites = 0;
+   #else
+    (void) interceptedCall;
+    (void) caller;
+   #endif
+}
+
+void AudioThreadProbe::clearExpectedViolations() noexcept
+{
+   #if TRIBASE_PROBE_INTERPOSE
+    numExpectedViolations = 0;
+    numClassifiedCallSites = 0;
+   #endif
+}
+} // namespace tribase::test
+
+//==============================================================================
+#if TRIBASE_PROBE_INTERPOSE
+extern "C"
+{
+void* malloc (size_t size)
+{
+    noteViolation (Violation::allocation, "malloc", size);
+    return rawMalloc (size);
+}
+
+void* calloc (size_t count, size_t size)
+{
+    noteViolation (Violation::allocation, "calloc", count * size);
+    return rawCalloc (count, size);
+}
+
+void* realloc (void* ptr, size_t size)
+{
+    noteViolation (Violation::allocation, "realloc", size);
+    return rawRealloc (ptr, size);
+}
+
+void* aligned_alloc (size_t alignment, size_t size)
+{
+    noteViolation (Violation::allocation, "aligned_alloc", size);
+    return rawAlignedAlloc (alignment, size);
+}
+
+int posix_memalign (void** result, size_t alignment, size_t size)
+{
+    noteViolation (Violation::allocation, "posix_memalign", size);
+    *result = rawAlignedAlloc (alignment, size);
+    return *result != nullptr ? 0 : ENOMEM;
+}
+
+void free (void* ptr)
+{
+    if (ptr != nullptr)
+        noteViolation (Violation::deallocation, "free");
+
+    rawFree (ptr);
+}
+
+//==============================================================================
+int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    noteViolation (Violation::lock, "pthread_mutex_lock");
+    return getReal().mutexLock (mutex);
+}
+
+int pthread_mutex_trylock (pthread_mutex_t* mutex)
+{
+    noteViolation (Violation::lock, "pthread_mutex_trylock");
+    return getReal().mutexTryLock (mutex);
+}
+
+int pthread_rwlock_rdlock (pthread_rwlock_t* lock)
+{
+    noteViolation (Violation::lock, "pthread_rwlock_rdlock");
+    return getReal().rwlockRead (lock);
+}
+
+int pthread_rwlock_wrlock (pthread_rwlock_t* lock)
+{
+    noteViolation (Violation::lock, "pthread_rwlock_wrlock");
+    return getReal().rwlockWrite (lock);
+}
+
+int pthread_cond_wait (pthread_cond_t* cond, pthread_mutex_t* mutex)
+{
+    noteViolation (Violation::lock, "pthread_cond_wait");
+    return getReal().condWait (cond, mutex);
+}
+
+int pthread_cond_timedwait (pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime)
+{
+    noteViolation (Violation::lock, "pthread_cond_timedwait");
+    return getReal().condTimedWait (cond, mutex, abstime);
+}
+
+int sem_wait (sem_t* semaphore)
+{
+    noteViolation (Violation::lock, "sem_wait");
+    return getReal().semWait (semaphore);
+}
+
+//==============================================================================
+int open (const char* path, int flags, ...)
+{
+    noteViolation (Violation::syscall, "open");
+
+    int mode = 0;
+
+    if ((flags & O_CREAT) != 0)
+    {
+        va_list args;
+        va_start (args, flags);
+        mode = va_arg (args, int);
+        va_end (args);
+    }
+
+    return getReal().open (path, flags, mode);
+}
+
+ssize_t read (int fd, void* data, size_t numBytes)
+{
+    noteViolation (Violation::syscall, "read");
+    return getReal().read (fd, data, numBytes);
+}
+
+ssize_t write (int fd, const void* data, size_t numBytes)
+{
+    noteViolation (Violation::syscall, "write");
+    return getReal().write (fd, data, numBytes);
+}
+
+int close (int fd)
+{
+    noteViolation (Violation::syscall, "close");
+    return getReal().close (fd);
+}
+
+int nanosleep (const struct timespec* duration, struct timespec* remaining)
+{
+    noteViolation (Violation::syscall, "nanosleep");
+    return getReal().nanosleep (duration, remaining);
+}
+
+int usleep (useconds_t micros)
+{
+    noteViolation (Violation::syscall, "usleep");
+    return getReal().usleep (micros);
+}
+
+int sched_yield()
+{
+    noteViolation (Violation::syscall, "sched_yield");
+    return getReal().schedYield();
+}
+}
+#endif
+
+//==============================================================================
+void* operator new (std::size_t size)                                        { return countedNew (size); }
+void* operator new[] (std::size_t size)                                      { return countedNew (size); }
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept        { try { return countedNew (size); } catch (...) { return nullptr; } }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept      { try { return countedNew (size); } catch (...) { return nullptr; } }
+void* operator new (std::size_t size, std::align_val_t align)                { return countedAlignedNew (size, align); }
+void* operator new[] (std::size_t size, std::align_val_t align)              { return countedAlignedNew (size, align); }
+
+void operator delete (void* ptr) noexcept                                    { countedDelete (ptr); }
+void operator delete[] (void* ptr) noexcept                                  { countedDelete (ptr); }
+void operator delete (void* ptr, std::size_t) noexcept                       { countedDelete (ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept                     { countedDelete (ptr); }
+void operator delete (void* ptr, const std::nothrow_t&) noexcept             { countedDelete (ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept           { countedDelete (ptr); }
+void operator delete (void* ptr, std::align_val_t) noexcept                  { countedDelete (ptr); }
+void operator delete[] (void* ptr, std::align_val_t) noexcept                { countedDelete (ptr); }
+void operator delete (void* ptr, std::size_t, std::align_val_t) noexcept     { countedDelete (ptr); }
+void operator delete[] (void* ptr, std::size_t, std::align_val_t) noexcept   { countedDelete (ptr); }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tribase::test
+{
+/** What the calling thread did while a probe window was open.
+
+    Everything counted here is forbidden on the audio thread: heap traffic, taking a lock
+    (mutex, rwlock, condition variable, semaphore) and blocking or I/O system calls
+    (read/write/open/close, sleeping, yielding).
+*/
+struct ProbeStats
+{
+    std::uint64_t allocations = 0;
+    std::uint64_t deallocations = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t locks = 0;
+    std::uint64_t syscalls = 0;
+
+    /** Calls that matched an expectViolation() entry. Counted, but not as violations. */
+    std::uint64_t expected = 0;
+
+    std::uint64_t getNumViolations() const noexcept { return allocations + deallocations + locks + syscalls; }
+
+    ProbeStats& operator+= (const ProbeStats& other) noexcept
+    {
+        allocations += other.allocations;
+        deallocations += other.deallocations;
+        bytes += other.bytes;
+        locks += other.locks;
+        syscalls += other.syscalls;
+        expected += other.expected;
+        return *this;
+    }
+};
+
+/** Watches the calling thread for real-time-unsafe calls.
+
+    The executable that links AudioThreadProbe.cpp replaces the malloc family, the global
+    operator new/delete, the pthread locking primitives and a handful of blocking system
+    calls with versions that forward to the C library and record the call when the current
+    thread has a window open. Threads that never open a window (message thread, JUCE timers)
+    are not counted. Interposition of the C functions is available with glibc and on Apple
+    platforms; elsewhere only operator new/delete are seen.
+*/
+class AudioThreadProbe
+{
+public:
+    /** Starts recording on the calling thread. Windows do not nest. */
+    static void begin() noexcept;
+
+    /** Stops recording on the calling thread and returns what happened since begin(). */
+    static ProbeStats end() noexcept;
+
+    static bool isActive() noexcept;
+
+    /** When enabled, the first hit from each distinct call site is printed to stderr with
+        the offending call and a symbolised stack, so the report points at the exact line
+        in processBlock that needs fixing. Off by default (the bench only wants counts).
+    */
+    static void setReportCallSites (bool shouldReport) noexcept;
+
+    /** Tags reports with the scenario that is running. The string must outlive the window. */
+    static void setContext (const char* description) noexcept;
+
+    /** Lets one known offender through. A call to interceptedCall (e.g. "pthread_mutex_lock")
+        whose nearest few callers include a function with caller in its demangled name (e.g.
+        "juce::Synthesiser::") counts as expected instead of as a violation. Only the frames
+        just above the intercepted call are looked at, so everything the allowed function
+        calls into is still checked. Both strings must outlive the probe.
+    */
+    static void expectViolation (const char* interceptedCall, const char* caller) noexcept;
+
+    static void clearExpectedViolations() noexcept;
+};
+
+/** RAII helper that keeps a probe window open for one scope. */
+class ScopedAudioThreadProbe
+{
+public:
+    ScopedAudioThreadProbe() noexcept { AudioThreadProbe::begin(); }
+    ~ScopedAudioThreadProbe() { if (! finished) AudioThreadProbe::end(); }
+
+    ProbeStats finish() noexcept
+    {
+        finished = true;
+        return AudioThreadProbe::end();
+    }
+
+private:
+    bool finished = false;
+};
+} // namespace tribase::test
@@ -0,0 +1,227 @@
+#include "HeadlessHarness.h"
+
+#include "effect/source/PluginProcessor.h"
+#include "instrument/source/PluginProcessor.h"
+#include "kick/source/PluginProcessor.h"
+
+#include <cmath>
+
+namespace tribase::test
+{
+namespace
+{
+constexpr double kBassHz = 55.0;
+constexpr double kKickPeriodSec = 0.5;    // quarter notes at 120 bpm
+constexpr double kNotePeriodSec = 0.125;  // sixteenths at 120 bpm
+constexpr double kNoteLengthSec = 0.0625;
+
+float kickSidechainSample (double timeInHit)
+{
+    if (timeInHit > 0.3)
+        return 0.0f;
+
+    const double sweepHz = 55.0 + 90.0 * std::exp (-timeInHit * 40.0);
+    const double body = std::sin (juce::MathConstants<double>::twoPi * sweepHz * timeInHit);
+    return static_cast<float> (0.9 * body * std::exp (-timeInHit * 14.0));
+}
+} // namespace
+
+const std::vector<ProcessorKind>& getAllProcessorKinds()
+{
+    static const std::vector<ProcessorKind> kinds { ProcessorKind::bassManager,
+                                                    ProcessorKind::kick,
+                                                    ProcessorKind::instrument };
+    return kinds;
+}
+
+juce::String getProcessorId (ProcessorKind kind)
+{
+    switch (kind)
+    {
+        case ProcessorKind::bassManager: return "bassmanager";
+        case ProcessorKind::kick:        return "kick";
+        case ProcessorKind::instrument:  return "instrument";
+    }
+
+    return {};
+}
+
+bool parseProcessorId (const juce::String& id, ProcessorKind& result)
+{
+    for (auto kind : getAllProcessorKinds())
+    {
+        if (getProcessorId (kind).equalsIgnoreCase (id.trim()))
+        {
+            result = kind;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::unique_ptr<juce::AudioProcessor> createProcessor (ProcessorKind kind)
+{
+    switch (kind)
+    {
+        case ProcessorKind::bassManager: return std::make_unique<TriBaseAudioProcessor>();
+        case ProcessorKind::kick:        return std::make_unique<TriBaseKickAudioProcessor>();
+        case ProcessorKind::instrument:  return std::make_unique<TriBaseInstrumentAudioProcessor>();
+    }
+
+    return {};
+}
+
+//==============================================================================
+template <typename FloatType>
+HeadlessSession<FloatType>::HeadlessSession (juce::AudioProcessor& processorToUse,
+                                             ProcessorKind kindToUse,
+                                             double newSampleRate,
+                                             int newBlockSize)
+    : processor (processorToUse),
+      kind (kindToUse),
+      sampleRate (newSampleRate),
+      blockSize (newBlockSize)
+{
+    constexpr bool isDouble = std::is_same_v<FloatType, double>;
+
+    processor.enableAllBuses();
+    processor.setProcessingPrecision (isDouble && processor.supportsDoublePrecisionProcessing()
+                                          ? juce::AudioProcessor::doublePrecision
+                                          : juce::AudioProcessor::singlePrecision);
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+
+    numMainChannels = processor.getMainBusNumInputChannels();
+
+    if (processor.getBusCount (true) > 1)
+    {
+        if (auto* bus = processor.getBus (true, 1); bus != nullptr && bus->isEnabled())
+        {
+            sidechainChannel = processor.getChannelIndexInProcessBlockBuffer (true, 1, 0);
+            numSidechainChannels = bus->getNumberOfChannels();
+        }
+    }
+
+    const int numChannels = juce::jmax (processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+    buffer.setSize (numChannels, blockSize);
+    buffer.clear();
+    midi.ensureSize (4096);
+}
+
+template <typename FloatType>
+HeadlessSession<FloatType>::~HeadlessSession()
+{
+    processor.releaseResources();
+}
+
+template <typename FloatType>
+void HeadlessSession<FloatType>::prepareNextBlock (bool automationStorm, int numSamples)
+{
+    if (automationStorm)
+        randomiseParameters();
+
+    numSamples = numSamples < 0 ? blockSize : juce::jlimit (1, blockSize, numSamples);
+
+    buffer.setSize (buffer.getNumChannels(), numSamples, false, false, true);
+    buffer.clear();
+    midi.clear();
+
+    if (kind == ProcessorKind::bassManager)
+    {
+        writeMainInput (numSamples);
+        writeSidechainInput (numSamples);
+    }
+
+    // The Bass Manager gets notes too, for its MIDI trigger mode.
+    writeNoteStream (numSamples);
+
+    position += numSamples;
+}
+
+template <typename FloatType>
+void HeadlessSession<FloatType>::process()
+{
+    processor.processBlock (buffer, midi);
+}
+
+template <typename FloatType>
+void HeadlessSession<FloatType>::writeMainInput (int numSamples)
+{
+    const double delta = juce::MathConstants<double>::twoPi * kBassHz / sampleRate;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto value = static_cast<FloatType> (0.5 * std::sin (bassPhase));
+        bassPhase += delta;
+
+        for (int ch = 0; ch < numMainChannels; ++ch)
+            buffer.setSample (ch, i, value);
+    }
+
+    bassPhase = std::fmod (bassPhase, juce::MathConstants<double>::twoPi);
+}
+
+template <typename FloatType>
+void HeadlessSession<FloatType>::writeSidechainInput (int numSamples)
+{
+    if (sidechainChannel < 0)
+        return;
+
+    const auto periodSamples = static_cast<juce::int64> (kKickPeriodSec * sampleRate);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto offset = (position + i) % periodSamples;
+        const auto value = static_cast<FloatType> (kickSidechainSample (static_cast<double> (offset) / sampleRate));
+
+        for (int ch = 0; ch < numSidechainChannels; ++ch)
+            buffer.setSample (sidechainChannel + ch, i, value);
+    }
+}
+
+template <typename FloatType>
+void HeadlessSession<FloatType>::writeNoteStream (int numSamples)
+{
+    const auto blockEnd = position + numSamples;
+    const auto periodSamples = static_cast<juce::int64> (kNotePeriodSec * sampleRate);
+    const auto lengthSamples = static_cast<juce::int64> (kNoteLengthSec * sampleRate);
+
+    while (true)
+    {
+        const bool offDue = pendingNoteOff >= 0 && pendingNoteOffSample < blockEnd;
+        const bool onDue = nextNoteSample < blockEnd;
+
+        if (offDue && (! onDue || pendingNoteOffSample <= nextNoteSample))
+        {
+            midi.addEvent (juce::MidiMessage::noteOff (1, pendingNoteOff),
+                           static_cast<int> (pendingNoteOffSample - position));
+            pendingNoteOff = -1;
+            continue;
+        }
+
+        if (! onDue)
+            break;
+
+        const int note = 36 + (noteIndex * 7) % 12;
+        const auto velocity = static_cast<juce::uint8> (64 + (noteIndex * 37) % 64);
+
+        midi.addEvent (juce::MidiMessage::noteOn (1, note, velocity), static_cast<int> (nextNoteSample - position));
+
+        pendingNoteOff = note;
+        pendingNoteOffSample = nextNoteSample + lengthSamples;
+        nextNoteSample += periodSamples;
+        ++noteIndex;
+    }
+}
+
+template <typename FloatType>
+void HeadlessSession<FloatType>::randomiseParameters()
+{
+    for (auto* parameter : processor.getParameters())
+        parameter->setValueNotifyingHost (random.nextFloat());
+}
+
+template class HeadlessSession<float>;
+template class HeadlessSession<double>;
+} // namespace tribase::test
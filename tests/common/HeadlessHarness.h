@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <memory>
+#include <vector>
+
+namespace tribase::test
+{
+enum class ProcessorKind
+{
+    bassManager,
+    kick,
+    instrument
+};
+
+const std::vector<ProcessorKind>& getAllProcessorKinds();
+juce::String getProcessorId (ProcessorKind kind);
+bool parseProcessorId (const juce::String& id, ProcessorKind& result);
+
+std::unique_ptr<juce::AudioProcessor> createProcessor (ProcessorKind kind);
+
+/** Drives one processor with no host and no device.
+
+    The session owns the process buffer and MIDI buffer. prepareNextBlock() writes the
+    synthetic input for the next block (a 55 Hz bass on the main bus, a kick pattern on the
+    sidechain, a note stream for every processor) and can randomise every parameter first,
+    which is how automation storms are produced. process() is the only call that touches
+    the processor's audio callback, so callers can time or probe it on its own.
+*/
+template <typename FloatType>
+class HeadlessSession
+{
+public:
+    HeadlessSession (juce::AudioProcessor& processorToUse, ProcessorKind kind, double sampleRate, int blockSize);
+    ~HeadlessSession();
+
+    /** Writes the input for the next block. numSamples may be anything up to the prepared
+        block size (hosts are free to send short blocks); -1 means a full block.
+    */
+    void prepareNextBlock (bool automationStorm, int numSamples = -1);
+    void process();
+
+    int getBlockSize() const noexcept { return blockSize; }
+    double getSampleRate() const noexcept { return sampleRate; }
+
+private:
+    void writeMainInput (int numSamples);
+    void writeSidechainInput (int numSamples);
+    void writeNoteStream (int numSamples);
+    void randomiseParameters();
+
+    juce::AudioProcessor& processor;
+    const ProcessorKind kind;
+    const double sampleRate;
+    const int blockSize;
+
+    juce::AudioBuffer<FloatType> buffer;
+    juce::MidiBuffer midi;
+    juce::Random random { 0x7b1ba5e };
+
+    int sidechainChannel = -1;
+    int numSidechainChannels = 0;
+    int numMainChannels = 0;
+
+    juce::int64 position = 0;
+    double bassPhase = 0.0;
+    juce::int64 nextNoteSample = 0;
+    juce::int64 pendingNoteOffSample = -1;
+    int pendingNoteOff = -1;
+    int noteIndex = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (HeadlessSession)
+};
+} // namespace tribase::test
@@ -0,0 +1,888 @@
+#include <JuceHeader.h>
+
+#include "dsp/Crossover.h"
+#include "dsp/Decimator.h"
+#include "dsp/FastMath.h"
+#include "dsp/GainComputer.h"
+#include "dsp/HitTemplate.h"
+#include "dsp/LookaheadDelay.h"
+#include "dsp/LookaheadDetector.h"
+#include "dsp/SidechainBank.h"
+#include "dsp/SpectralDucker.h"
+#include "dsp/TempoCurve.h"
+#include "kick/source/KickRenderCache.h"
+#include "kick/source/KickVoicePool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Behaviour checks for the shared DSP blocks and the kick engine, one named check per
+// ctest entry. Each runs a block directly, without a processor around it, against a
+// figure worked out by hand or from the analytic curve it stands in for.
+
+namespace
+{
+// Prints a failed expectation and passes the result on, so a check reports every
+// expectation it misses rather than only the first.
+bool expect (bool condition, const std::string& what)
+{
+    if (! condition)
+        std::cout << "      expected " << what << std::endl;
+
+    return condition;
+}
+
+float maxAbsDifference (const std::vector<float>& a, const std::vector<float>& b)
+{
+    float worst = 0.0f;
+
+    for (size_t i = 0; i < juce::jmin (a.size(), b.size()); ++i)
+        worst = juce::jmax (worst, std::abs (a[i] - b[i]));
+
+    return worst;
+}
+
+//==============================================================================
+bool checkLookaheadDelay()
+{
+    // A 200 Hz sine at 48 kHz through lookahead changes, growing from zero and shrinking.
+    // The sine never moves by more than omega per sample. Neither may the delayed signal
+    // across a growth; a shrink fades the dropped samples out over the kept ones, which
+    // plays the signal up to dropped / kept faster for a moment.
+    constexpr double sampleRate = 48000.0;
+    constexpr double omega = juce::MathConstants<double>::twoPi * 200.0 / sampleRate;
+    constexpr int block = 64;
+    constexpr int blocksPerDelay = 20;
+    const int delays[] = { 0, 200, 480, 1000, 300, 299, 700 };
+
+    LookaheadDelay<float> delay;
+    delay.prepare (1, 1024);
+
+    std::vector<float> data (block);
+    double phase = 0.0;
+    float previous = 0.0f;
+    int previousDelay = 0;
+    bool ok = true;
+
+    for (const int samples : delays)
+    {
+        delay.setDelay (samples);
+
+        const double speed = samples < previousDelay ? 1.0 + static_cast<double> (previousDelay - samples) / samples : 1.0;
+        const auto allowed = static_cast<float> (omega * speed * 1.0001);
+        float largestStep = 0.0f;
+
+        for (int b = 0; b < blocksPerDelay; ++b)
+        {
+            for (auto& x : data)
+            {
+                x = static_cast<float> (std::sin (phase));
+                phase += omega;
+            }
+
+            auto* channel = data.data();
+            delay.process (&channel, 1, block);
+
+            for (const auto x : data)
+            {
+                largestStep = juce::jmax (largestStep, std::abs (x - previous));
+                previous = x;
+            }
+        }
+
+        ok &= expect (largestStep <= allowed, "no step larger than " + std::to_string (allowed) + " going from "
+                                                  + std::to_string (previousDelay) + " to " + std::to_string (samples)
+                                                  + " samples (got " + std::to_string (largestStep) + ")");
+        previousDelay = samples;
+    }
+
+    return ok;
+}
+
+//==============================================================================
+// Decimates a sine and fits a sine at the frequency it lands on, returning its amplitude
+// and its delay in host samples.
+std::pair<double, double> decimateSine (double sampleRate, int factor, double hz)
+{
+    Decimator<double> decimator;
+    decimator.prepare (factor);
+
+    const auto numSamples = static_cast<int> (sampleRate);
+    std::vector<double> data (static_cast<size_t> (numSamples));
+
+    for (int i = 0; i < numSamples; ++i)
+        data[static_cast<size_t> (i)] = std::sin (juce::MathConstants<double>::twoPi * hz * i / sampleRate);
+
+    const int numOut = decimator.process (data.data(), data.data(), numSamples);
+
+    // Each output belongs to the input that completed it, 'factor' inputs after the last.
+    const double outputRate = sampleRate / factor;
+    double landsOn = std::fmod (hz, outputRate);
+    landsOn = juce::jmin (landsOn, outputRate - landsOn);
+
+    double c = 0.0, s = 0.0;
+
+    for (int k = numOut / 2; k < numOut; ++k)
+    {
+        const double t = ((k + 1) * factor - 1) / sampleRate;
+        c += data[static_cast<size_t> (k)] * std::cos (juce::MathConstants<double>::twoPi * landsOn * t);
+        s += data[static_cast<size_t> (k)] * std::sin (juce::MathConstants<double>::twoPi * landsOn * t);
+    }
+
+    const double amplitude = 2.0 * std::sqrt (c * c + s * s) / (numOut - numOut / 2);
+    const double delay = -std::atan2 (c, s) / (juce::MathConstants<double>::twoPi * hz) * sampleRate;
+    return { amplitude, delay };
+}
+
+bool checkDecimator()
+{
+    bool ok = true;
+
+    for (const auto& [sampleRate, factor] : { std::pair { 48000.0, 4 }, std::pair { 192000.0, 16 } })
+    {
+        const auto rate = " at " + std::to_string (static_cast<int> (sampleRate)) + " Hz";
+
+        Decimator<double> decimator;
+        decimator.prepare (factor);
+
+        // The detector band passes untouched and as late as the detector reports.
+        const auto [passAmplitude, passDelay] = decimateSine (sampleRate, factor, 60.0);
+        ok &= expect (std::abs (passDelay - decimator.getLatencySamples()) < 0.01,
+                      "60 Hz to come out " + std::to_string (decimator.getLatencySamples()) + " samples late" + rate
+                          + " (got " + std::to_string (passDelay) + ")");
+        ok &= expect (std::abs (juce::Decibels::gainToDecibels (passAmplitude)) < 0.01,
+                      "60 Hz to pass within 0.01 dB" + rate + " (got " + std::to_string (passAmplitude) + ")");
+
+        // Whatever would fold into it is at least 75 dB down.
+        const double outputRate = sampleRate / factor;
+        double worstDb = -200.0;
+
+        for (double centre = outputRate; centre - 150.0 < sampleRate / 2.0; centre += outputRate)
+            for (const double offset : { -150.0, -75.0, 0.0, 75.0, 150.0 })
+                if (centre + offset < sampleRate / 2.0)
+                    worstDb = juce::jmax (worstDb, juce::Decibels::gainToDecibels (decimateSine (sampleRate, factor, centre + offset).first, -200.0));
+
+        ok &= expect (worstDb < -75.0, "aliases into the detector band 75 dB down" + rate + " (got " + std::to_string (worstDb) + " dB)");
+    }
+
+    return ok;
+}
+
+//==============================================================================
+bool checkHitTemplate()
+{
+    // At 1 kHz a template is 250 samples long; the take runs on by the advance.
+    constexpr double sampleRate = 1000.0;
+    constexpr int advance = 8;
+    constexpr int block = 300;
+
+    const auto curveAt = [] (int k) { return 1.0f - 0.5f * std::exp (-static_cast<float> (k) / 40.0f); };
+
+    HitTemplate hits;
+    hits.prepare (sampleRate, advance);
+    hits.setParameters (-20.0f, 0.0f);   // onset at 0.1, re-armed below 0.05
+    hits.setAdvance (advance);
+
+    std::vector<float> envelope (block, 0.0f);
+    std::vector<float> gains (block);
+    bool ok = true;
+
+    // Under the threshold: nothing is learned and the curve passes through untouched.
+    std::fill (envelope.begin(), envelope.end(), 0.08f);
+    std::fill (gains.begin(), gains.end(), 0.9f);
+    ok &= expect (hits.process (envelope.data(), gains.data(), block, true), "a quiet block to stay flat");
+    ok &= expect (! hits.hasTemplate(), "no template from a level under the threshold");
+    ok &= expect (gains.front() == 0.9f && gains.back() == 0.9f, "gains under the threshold left alone");
+
+    // One onset, then silence so it re-arms, with a known curve to learn.
+    std::fill (envelope.begin(), envelope.end(), 0.0f);
+    envelope[0] = 0.5f;
+
+    for (int k = 0; k < block; ++k)
+        gains[static_cast<size_t> (k)] = curveAt (k);
+
+    hits.process (envelope.data(), gains.data(), block, false);
+    ok &= expect (hits.hasTemplate(), "a template after one whole take");
+
+    // The next onset plays the take straight away, read ahead by the advance.
+    std::fill (gains.begin(), gains.end(), 1.0f);
+    hits.process (envelope.data(), gains.data(), block, false);
+
+    float worst = 0.0f;
+
+    for (int k = 0; k < 250; ++k)
+        worst = juce::jmax (worst, std::abs (gains[static_cast<size_t> (k)] - curveAt (k + advance)));
+
+    ok &= expect (worst < 1.0e-6f, "playback to match the take advanced by " + std::to_string (advance)
+                                       + " samples (off by " + std::to_string (worst) + ")");
+    ok &= expect (gains[250] == 1.0f, "unity once the template has played out");
+
+    // Six constant takes: the template is the plain mean of the last four.
+    HitTemplate averaged;
+    averaged.prepare (sampleRate, 0);
+    averaged.setParameters (-20.0f, 0.0f);
+
+    for (int take = 1; take <= 6; ++take)
+    {
+        std::fill (gains.begin(), gains.end(), 0.1f * static_cast<float> (take));
+        averaged.process (envelope.data(), gains.data(), block, false);
+    }
+
+    std::fill (gains.begin(), gains.end(), 1.0f);
+    averaged.process (envelope.data(), gains.data(), block, false);
+    ok &= expect (std::abs (gains[100] - 0.45f) < 1.0e-6f,
+                  "the mean of the last four takes, 0.45 (got " + std::to_string (gains[100]) + ")");
+
+    // The running sums are updated per take and rebuilt behind it, so a long session ends
+    // on the same mean.
+    const auto levelOf = [] (int take) { return 0.05f + 0.09f * static_cast<float> ((take * 7) % 11); };
+
+    for (int take = 1; take <= 1000; ++take)
+    {
+        std::fill (gains.begin(), gains.end(), levelOf (take));
+        averaged.process (envelope.data(), gains.data(), block, false);
+    }
+
+    const float mean = 0.25f * (levelOf (997) + levelOf (998) + levelOf (999) + levelOf (1000));
+
+    std::fill (gains.begin(), gains.end(), 1.0f);
+    averaged.process (envelope.data(), gains.data(), 8, false);
+    ok &= expect (std::abs (gains[0] - mean) < 1.0e-6f && std::abs (gains[7] - mean) < 1.0e-6f,
+                  "the mean of the last four after 1000 takes, " + std::to_string (mean)
+                      + " (got " + std::to_string (gains[0]) + ")");
+
+    return ok;
+}
+
+//==============================================================================
+bool checkTempoCurve()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr double bpm = 120.0;
+
+    const auto makeCurve = [] (TempoCurve& curve)
+    {
+        curve.prepare (sampleRate);
+        curve.setParameters (12.0f, 0.0f, 1.0, 0.5f, 0.5f);
+        curve.setTempo (bpm);
+    };
+
+    bool ok = true;
+    float gain = 0.0f;
+
+    // Every beat opens at full depth, wherever the transport jumps to.
+    for (const double beat : { 0.0, 3.0, 17.0 })
+    {
+        TempoCurve curve;
+        makeCurve (curve);
+        curve.setPpqPosition (beat);
+        curve.process (&gain, 1);
+        ok &= expect (std::abs (gain - juce::Decibels::decibelsToGain (-12.0f)) < 1.0e-5f,
+                      "full depth on beat " + std::to_string (beat) + " (got " + std::to_string (gain) + ")");
+    }
+
+    // Locked once and left to run, the curve stays where a relock would put it.
+    constexpr int run = 4800;
+    const double ppq = 3.25;
+
+    TempoCurve running, relocked;
+    makeCurve (running);
+    makeCurve (relocked);
+
+    std::vector<float> gains (run + 1);
+    running.setPpqPosition (ppq);
+    running.process (gains.data(), run + 1);
+
+    relocked.setPpqPosition (ppq + run * bpm / (60.0 * sampleRate));
+    relocked.process (&gain, 1);
+
+    ok &= expect (std::abs (gains[run] - gain) < 1.0e-5f,
+                  "a free-running curve in phase with a relocked one (" + std::to_string (gains[run])
+                      + " vs " + std::to_string (gain) + ")");
+
+    return ok;
+}
+
+//==============================================================================
+bool checkSpectralNull()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int block = 512;
+    constexpr int numBlocks = 24;
+
+    std::mt19937 rng (7);
+    std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+
+    std::vector<float> left (block), right (block), sc (block);
+    const float* channels[] = { left.data(), right.data() };
+    const float* scChannels[] = { sc.data() };
+
+    // Returns the largest residual sample over a run of noise with a loud sidechain.
+    const auto largestResidual = [&] (float thresholdDb, float depthDb)
+    {
+        SpectralDucker<float> ducker;
+        ducker.prepare (sampleRate, 2, block);
+        ducker.setParameters (thresholdDb, 4.0f, depthDb, 5.0f, 50.0f);
+
+        float largest = 0.0f;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (int i = 0; i < block; ++i)
+            {
+                left[static_cast<size_t> (i)] = noise (rng);
+                right[static_cast<size_t> (i)] = noise (rng);
+                sc[static_cast<size_t> (i)] = 0.5f * noise (rng);
+            }
+
+            ducker.process (channels, 2, scChannels, 1, block);
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < block; ++i)
+                    largest = juce::jmax (largest, std::abs (ducker.getResidual (ch)[i]));
+        }
+
+        return largest;
+    };
+
+    bool ok = true;
+    ok &= expect (largestResidual (-60.0f, 0.0f) == 0.0f, "no residual with no depth");
+    ok &= expect (largestResidual (6.0f, 24.0f) == 0.0f, "no residual with the sidechain under the threshold");
+
+    // And the same run with room to reduce does take something out, so the two above mean
+    // something.
+    ok &= expect (largestResidual (-60.0f, 24.0f) > 0.01f, "a residual once the sidechain is over the threshold");
+
+    return ok;
+}
+
+//==============================================================================
+bool checkSpectralLatency()
+{
+    // With every bin held at the same depth the residual is just the input scaled, as late
+    // as the ducker reports: about 5 ms, though the bins are still a whole frame wide.
+    bool ok = true;
+
+    for (const double sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+    {
+        constexpr int block = 512;
+        constexpr float depthDb = 12.0f;
+
+        SpectralDucker<float> ducker;
+        ducker.prepare (sampleRate, 1, block);
+
+        // A threshold under the -60 dB floor puts every bin past the depth limit.
+        ducker.setParameters (-100.0f, 100.0f, depthDb, 0.0f, 0.0f);
+
+        const int latency = ducker.getLatencySamples();
+        const float latencyMs = static_cast<float> (1000.0 * latency / sampleRate);
+        const float removed = 1.0f - juce::Decibels::decibelsToGain (-depthDb);
+
+        std::mt19937 rng (3);
+        std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+        std::vector<float> input, residual;
+        std::vector<float> data (block), sc (block);
+        const float* channels[] = { data.data() };
+        const float* scChannels[] = { sc.data() };
+
+        for (int b = 0; b < 48; ++b)
+        {
+            for (int i = 0; i < block; ++i)
+            {
+                data[static_cast<size_t> (i)] = noise (rng);
+                sc[static_cast<size_t> (i)] = 0.5f * noise (rng);
+            }
+
+            ducker.process (channels, 1, scChannels, 1, block);
+            input.insert (input.end(), data.begin(), data.end());
+            residual.insert (residual.end(), ducker.getResidual (0), ducker.getResidual (0) + block);
+        }
+
+        float worst = 0.0f;
+
+        for (size_t i = input.size() / 2; i < input.size(); ++i)
+            worst = juce::jmax (worst, std::abs (residual[i] - removed * input[i - static_cast<size_t> (latency)]));
+
+        const auto rate = " at " + std::to_string (static_cast<int> (sampleRate)) + " Hz";
+        ok &= expect (latencyMs < 6.0f, "a latency under 6 ms" + rate + " (got " + std::to_string (latencyMs) + " ms)");
+        ok &= expect (worst < 1.0e-4f, "the residual to be the input " + std::to_string (latency) + " samples late, scaled"
+                                           + rate + " (off by " + std::to_string (worst) + ")");
+    }
+
+    return ok;
+}
+
+//==============================================================================
+bool checkChannelRemap()
+{
+    // Channels handed over to new positions carry on exactly as if they had always been
+    // there: a ducker or crossover that only ever saw them is the reference.
+    constexpr double sampleRate = 48000.0;
+    constexpr int block = 256;
+
+    std::mt19937 rng (11);
+    std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+
+    std::vector<std::vector<float>> data (3, std::vector<float> (block));
+    std::vector<float> sc (block);
+    const float* scChannels[] = { sc.data() };
+
+    const auto fill = [&]
+    {
+        for (auto& channel : data)
+            for (auto& x : channel)
+                x = noise (rng);
+
+        for (auto& x : sc)
+            x = 0.5f * noise (rng);
+    };
+
+    SpectralDucker<float> remapped, reference;
+
+    for (auto* ducker : { &remapped, &reference })
+    {
+        ducker->prepare (sampleRate, 3, block);
+        ducker->setParameters (-60.0f, 4.0f, 24.0f, 5.0f, 50.0f);
+    }
+
+    bool ok = true;
+    float worst = 0.0f;
+
+    // All three channels, then the first one dropped, then brought back in front.
+    const int previousDropped[] = { 1, 2 };
+    const int previousAdded[] = { -1, 0, 1 };
+
+    for (int b = 0; b < 24; ++b)
+    {
+        fill();
+
+        if (b == 8)
+            remapped.remapChannels (previousDropped, 2);
+        else if (b == 16)
+            remapped.remapChannels (previousAdded, 3);
+
+        const int first = b >= 8 && b < 16 ? 1 : 0;
+        const float* all[] = { data[0].data(), data[1].data(), data[2].data() };
+
+        remapped.process (all + first, 3 - first, scChannels, 1, block);
+        reference.process (all + 1, 2, scChannels, 1, block);
+
+        if (b >= 8)
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < block; ++i)
+                    worst = juce::jmax (worst, std::abs (remapped.getResidual (ch + 1 - first)[i] - reference.getResidual (ch)[i]));
+    }
+
+    ok &= expect (worst == 0.0f, "remapped spectral channels to match the reference (off by " + std::to_string (worst) + ")");
+
+    // The same hand-over for the crossover, through its per-channel state.
+    Crossover<float> split, splitReference;
+    split.prepare (sampleRate, 3);
+    splitReference.prepare (sampleRate, 3);
+
+    const std::vector<float> gains (block, 0.25f);
+    worst = 0.0f;
+
+    for (int b = 0; b < 8; ++b)
+    {
+        fill();
+        auto expected = data;
+
+        if (b == 4)
+        {
+            split.setChannelState (0, split.getChannelState (1));
+            split.setChannelState (1, split.getChannelState (2));
+        }
+
+        const int first = b >= 4 ? 1 : 0;
+        float* all[] = { data[0].data(), data[1].data(), data[2].data() };
+        float* reference[] = { expected[1].data(), expected[2].data() };
+
+        split.process (all + first, 3 - first, 0, gains.data(), block);
+        splitReference.process (reference, 2, 0, gains.data(), block);
+
+        if (b >= 4)
+            worst = juce::jmax (worst, juce::jmax (maxAbsDifference (data[1], expected[1]), maxAbsDifference (data[2], expected[2])));
+    }
+
+    ok &= expect (worst == 0.0f, "remapped crossover channels to match the reference (off by " + std::to_string (worst) + ")");
+
+    return ok;
+}
+
+//==============================================================================
+bool checkSidechainBank()
+{
+    constexpr int block = 64;
+
+    SidechainBank<float> bank;
+    bank.prepare (48000.0, block);
+
+    // No filters, so each lane's level is its downmix times its scale, up to its ceiling.
+    bank.setLane (0, 0, 0.0f, 0.0f, 2.0f, 10.0f);
+    bank.setLane (1, 0, 0.0f, 0.0f, 0.5f, 10.0f);
+    bank.setLane (2, 0, 0.0f, 0.0f, 4.0f, 0.8f);
+    bank.setLane (3, 0, 0.0f, 0.0f, 1.0f, 10.0f);
+
+    const std::vector<float> low (block, 0.4f), high (block, 0.6f), half (block, -0.5f);
+    const float* pair[] = { low.data(), high.data() };
+    const float* single[] = { half.data() };
+
+    const auto run = [&] (SidechainCombine combine)
+    {
+        bank.setCombine (combine);
+        bank.loadLane (0, pair, 2, block);     // averages to 0.5, scaled to 1.0
+        bank.loadLane (1, single, 1, block);   // |-0.5| scaled to 0.25
+        bank.loadLane (2, single, 1, block);   // 2.0, held to its 0.8 ceiling
+        bank.loadLane (3, nullptr, 0, block);  // no bus reads as silence
+        return bank.process (block)[block - 1];
+    };
+
+    bool ok = true;
+    const float loudest = run (SidechainCombine::max);
+    const float total = run (SidechainCombine::sum);
+
+    ok &= expect (std::abs (loudest - 1.0f) < 1.0e-6f, "max of the scaled lanes to be 1.0 (got " + std::to_string (loudest) + ")");
+    ok &= expect (std::abs (total - 2.05f) < 1.0e-6f, "sum of the scaled lanes to be 2.05 (got " + std::to_string (total) + ")");
+
+    // Fed through the detector's own downmix, the main input alone gives the envelope the
+    // single-input path does, surround weights and link included.
+    std::vector<float> left (block), right (block), surround (block), mono (block);
+
+    for (int i = 0; i < block; ++i)
+    {
+        left[static_cast<size_t> (i)] = std::sin (0.05f * static_cast<float> (i));
+        right[static_cast<size_t> (i)] = 0.8f * std::sin (0.031f * static_cast<float> (i) + 1.0f);
+        surround[static_cast<size_t> (i)] = 0.9f * std::sin (0.07f * static_cast<float> (i));
+    }
+
+    const float* bed[] = { left.data(), right.data(), surround.data() };
+    const float weights[] = { 1.0f, 1.0f, 0.70710678f };
+
+    for (const auto link : { SidechainLink::sum, SidechainLink::max })
+    {
+        LookaheadDetector<float> direct, banked;
+
+        for (auto* detector : { &direct, &banked })
+        {
+            detector->prepare (48000.0, block);
+            detector->setChannelWeights (weights, 3);
+            detector->setFilter (1, 60.0f, 200.0f);
+            detector->setLink (link);
+            detector->setLookaheadMs (2.0f);
+        }
+
+        SidechainBank<float> mainOnly;
+        mainOnly.prepare (48000.0, block);
+        mainOnly.setLane (0, 1, 60.0f, 200.0f, 1.0f, std::numeric_limits<float>::max());
+
+        float worst = 0.0f;
+
+        for (int pass = 0; pass < 4; ++pass)
+        {
+            const float* single = direct.processSidechain (bed, 3, 0, block);
+            const std::vector<float> expected (single, single + block);
+
+            float* const downmixed = mono.data();
+            banked.downmix (bed, 3, 0, downmixed, block);
+            mainOnly.loadLane (0, &downmixed, 1, block);
+
+            for (int lane = 1; lane < SidechainBank<float>::lanes; ++lane)
+                mainOnly.loadLane (lane, nullptr, 0, block);
+
+            const float* merged = banked.processDetection (mainOnly.process (block), block);
+            worst = juce::jmax (worst, maxAbsDifference (expected, std::vector<float> (merged, merged + block)));
+        }
+
+        ok &= expect (worst < 1.0e-6f, std::string ("the main input to give the same envelope through the bank with ")
+                                           + (link == SidechainLink::max ? "max" : "sum") + " link (off by "
+                                           + std::to_string (worst) + ")");
+    }
+
+    return ok;
+}
+
+//==============================================================================
+bool checkGainTable()
+{
+    struct Setting
+    {
+        float thresholdDb, ratio, kneeDb, depthDb, makeupDb;
+    };
+
+    // Hard and soft knees, a shallow depth that ends inside the knee, and a gentle ratio
+    // whose slope runs past 0 dB.
+    const Setting settings[] = { { -24.0f, 4.0f, 0.0f, 18.0f, 0.0f },
+                                 { -37.3f, 8.0f, 0.0f, 3.0f, 2.0f },
+                                 { -24.0f, 4.0f, 6.0f, 18.0f, 0.0f },
+                                 { -24.0f, 4.0f, 24.0f, 1.0f, 0.0f },
+                                 { -20.0f, 1.01f, 0.0f, 18.0f, -3.0f } };
+
+    bool ok = true;
+
+    for (const auto& s : settings)
+    {
+        GainComputer computer;
+        computer.prepare (48000.0);
+        // Instant attack and release, so the follower sits on each level fed in.
+        computer.setParameters (s.thresholdDb, s.ratio, s.kneeDb, s.depthDb, s.makeupDb, 0.0f, 0.0f);
+
+        const float slope = 1.0f - 1.0f / s.ratio;
+        float worstDb = 0.0f;
+
+        for (int step = 0; step <= 60000; ++step)
+        {
+            const float x = juce::jlimit (1.0e-6f, 1.0f, juce::Decibels::decibelsToGain (-60.0f + 0.001f * static_cast<float> (step)));
+            float gain = 0.0f;
+            computer.processTile (&x, &gain, 1);
+
+            // The analytic curve, at the level the computer sees.
+            const float over = juce::jmax (-60.0f, fastmath::gainToDb (x)) - s.thresholdDb;
+            float reduction = 0.0f;
+
+            if (2.0f * over >= s.kneeDb)
+                reduction = over * slope;
+            else if (2.0f * over > -s.kneeDb)
+                reduction = slope * juce::square (over + 0.5f * s.kneeDb) / (2.0f * s.kneeDb);
+
+            const float wantDb = s.makeupDb - juce::jmin (s.depthDb, reduction);
+            worstDb = juce::jmax (worstDb, std::abs (juce::Decibels::gainToDecibels (gain, -200.0f) - wantDb));
+        }
+
+        ok &= expect (worstDb < 1.0e-3f, "the table within 0.001 dB of the curve at threshold "
+                                             + std::to_string (s.thresholdDb) + ", knee " + std::to_string (s.kneeDb)
+                                             + " (off by " + std::to_string (worstDb) + " dB)");
+    }
+
+    return ok;
+}
+
+//==============================================================================
+// Renders a pool until it falls silent, up to maxSamples, and returns what it played.
+std::vector<float> renderUntilSilent (KickVoicePool& pool, int maxSamples)
+{
+    std::vector<float> out;
+    std::vector<float> block (KickVoicePool::controlBlock * 2);
+
+    while (pool.isActive() && static_cast<int> (out.size()) < maxSamples)
+    {
+        std::fill (block.begin(), block.end(), 0.0f);
+        pool.renderBlock (block.data(), static_cast<int> (block.size()));
+        out.insert (out.end(), block.begin(), block.end());
+    }
+
+    return out;
+}
+
+bool checkKickVoices()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int oneSecond = 48000;
+
+    bool ok = true;
+
+    // A hit ends by itself, after the same time whatever its velocity.
+    int lengths[2] {};
+
+    for (int v = 0; v < 2; ++v)
+    {
+        KickVoicePool pool;
+        pool.prepare (sampleRate);
+        pool.trigger (KickParams(), v == 0 ? 1.0 : 0.25);
+        lengths[v] = static_cast<int> (renderUntilSilent (pool, oneSecond).size());
+    }
+
+    ok &= expect (lengths[0] < oneSecond, "a default hit to end within a second (still going after "
+                                              + std::to_string (lengths[0]) + " samples)");
+    ok &= expect (lengths[0] == lengths[1], "the same length at any velocity (" + std::to_string (lengths[0])
+                                                + " vs " + std::to_string (lengths[1]) + ")");
+
+    // A roll of twice as many hits as lanes, each after the last one's steal fade: every
+    // voice that makes way fades out, so nothing jumps. Without the click the output
+    // moves a few hundredths per sample; a voice cut off mid-tail jumps by far more.
+    KickParams roll;
+    roll.clickLevel = 0.0;
+
+    KickVoicePool pool;
+    pool.prepare (sampleRate);
+
+    constexpr int spacing = 288;   // 6 ms, past the 5 ms fade
+    std::vector<float> out;
+    std::vector<float> block (spacing);
+
+    for (int hit = 0; hit < 2 * KickVoicePool::lanes; ++hit)
+    {
+        pool.trigger (roll, 1.0);
+        std::fill (block.begin(), block.end(), 0.0f);
+        pool.renderBlock (block.data(), spacing);
+        out.insert (out.end(), block.begin(), block.end());
+    }
+
+    const auto tail = renderUntilSilent (pool, 4 * oneSecond);
+    out.insert (out.end(), tail.begin(), tail.end());
+
+    float largestStep = 0.0f;
+
+    for (size_t i = 1; i < out.size(); ++i)
+        largestStep = juce::jmax (largestStep, std::abs (out[i] - out[i - 1]));
+
+    ok &= expect (largestStep < 0.1f, "no jump larger than 0.1 across a roll (got " + std::to_string (largestStep) + ")");
+    ok &= expect (! pool.isActive(), "every voice of the roll to end");
+
+    return ok;
+}
+
+// A hit doesn't depend on what its lane played before: trigger reseeds the click noise,
+// so the same hit after another one matches the first hit on a fresh pool sample for sample.
+bool checkKickClickHistory()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int oneSecond = 48000;
+
+    KickParams before;
+    before.clickLevel = 1.0;
+    before.tailLevel = 0.0;
+
+    const KickParams hit;
+
+    KickVoicePool used;
+    used.prepare (sampleRate);
+    used.trigger (before, 1.0);
+    renderUntilSilent (used, oneSecond);
+    used.trigger (hit, 1.0);
+    const auto afterOther = renderUntilSilent (used, oneSecond);
+
+    KickVoicePool fresh;
+    fresh.prepare (sampleRate);
+    fresh.trigger (hit, 1.0);
+    const auto onItsOwn = renderUntilSilent (fresh, oneSecond);
+
+    return expect (afterOther == onItsOwn, "a hit after another one to match a hit on a fresh pool exactly (off by "
+                                               + std::to_string (maxAbsDifference (afterOther, onItsOwn)) + ")");
+}
+
+//==============================================================================
+bool checkKickCache()
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int length = 3 * 48000;
+    constexpr double velocity = 0.7;
+
+    bool ok = true;
+
+    KickParams hot;
+    hot.driveGain = 1.0;
+    hot.outputGain = juce::Decibels::decibelsToGain (6.0);
+    ok &= expect (! KickRenderCache::canCache (hot), "a hit the output limiter can reach to stay live");
+
+    const KickParams params;
+    ok &= expect (KickRenderCache::canCache (params), "a default hit to be cacheable");
+
+    KickRenderCache cache;
+    cache.prepare (sampleRate);
+
+    const auto key = KickRenderCache::makeKey (params);
+    cache.request (params, key);
+
+    // The render thread polls, so give it a couple of seconds to get there.
+    bool started = false;
+
+    for (int attempt = 0; attempt < 200 && ! started; ++attempt)
+    {
+        started = cache.trigger (key, velocity);
+
+        if (! started)
+            std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    }
+
+    ok &= expect (started, "the requested hit to be rendered");
+
+    if (! started)
+        return false;
+
+    std::vector<float> cached (length, 0.0f), live (length, 0.0f);
+
+    for (int start = 0; start < length; start += 512)
+        cache.renderBlock (cached.data() + start, juce::jmin (512, length - start));
+
+    KickVoicePool pool;
+    pool.prepare (sampleRate);
+    pool.trigger (params, velocity);
+    pool.renderBlock (live.data(), length);
+
+    const float difference = maxAbsDifference (cached, live);
+    ok &= expect (difference < 1.0e-6f, "cached playback to match a live hit (off by " + std::to_string (difference) + ")");
+
+    cache.release();
+    return ok;
+}
+
+struct Check
+{
+    const char* name;
+    bool (*run)();
+};
+
+const Check checks[] = { { "lookahead-delay",    checkLookaheadDelay },
+                         { "decimator",          checkDecimator },
+                         { "hit-template",       checkHitTemplate },
+                         { "tempo-curve",        checkTempoCurve },
+                         { "spectral-null",      checkSpectralNull },
+                         { "spectral-latency",   checkSpectralLatency },
+                         { "channel-remap",      checkChannelRemap },
+                         { "sidechain-bank",     checkSidechainBank },
+                         { "gain-table",         checkGainTable },
+                         { "kick-voices",        checkKickVoices },
+                         { "kick-click-history", checkKickClickHistory },
+                         { "kick-cache",         checkKickCache } };
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+    const juce::ArgumentList args (argc, argv);
+
+    juce::StringArray selected;
+
+    if (const auto names = args.getValueForOption ("--checks"); names.isNotEmpty())
+    {
+        selected = juce::StringArray::fromTokens (names, ",", {});
+
+        for (auto& name : selected)
+        {
+            if (std::none_of (std::begin (checks), std::end (checks), [&] (const Check& c) { return name == c.name; }))
+            {
+                std::cerr << "Unknown check: " << name << "\n";
+                return 2;
+            }
+        }
+    }
+
+    int failures = 0;
+
+    for (const auto& check : checks)
+    {
+        if (! selected.isEmpty() && ! selected.contains (check.name))
+            continue;
+
+        const bool passed = check.run();
+        std::cout << (passed ? "PASS  " : "FAIL  ") << check.name << std::endl;
+
+        if (! passed)
+            ++failures;
+    }
+
+    if (failures > 0)
+    {
+        std::cout << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
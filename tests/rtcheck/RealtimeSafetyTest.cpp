@@ -0,0 +1,173 @@
+#include <JuceHeader.h>
+
+#include "common/AudioThreadProbe.h"
+#include "common/HeadlessHarness.h"
+
+#include <iostream>
+
+// Runs processBlock under the audio-thread probe and fails on any allocation, lock or
+// blocking system call. Each distinct call site is printed once, as the intercepted call
+// followed by the stack that led to it from processBlock. The target is built with
+// ENABLE_EXPORTS so those frames resolve to function names. The few known offenders that
+// can't be fixed from here are listed in knownViolations; they are counted apart, and any
+// other violation in the same processor still fails.
+
+namespace
+{
+using tribase::test::ProcessorKind;
+
+constexpr int blocksPerScenario = 96;
+
+struct KnownViolation
+{
+    ProcessorKind kind;
+    const char* interceptedCall;
+    const char* caller;
+};
+
+// Drop an entry once its fix lands.
+const KnownViolation knownViolations[] = {
+    // juce::Synthesiser guards its voices and sounds with a CriticalSection, taken for every
+    // block and every note it handles.
+    { ProcessorKind::instrument, "pthread_mutex_lock", "juce::Synthesiser::" },
+};
+
+void expectKnownViolations (ProcessorKind kind)
+{
+    tribase::test::AudioThreadProbe::clearExpectedViolations();
+
+    for (const auto& known : knownViolations)
+        if (known.kind == kind)
+            tribase::test::AudioThreadProbe::expectViolation (known.interceptedCall, known.caller);
+}
+
+enum class Scenario
+{
+    steady,
+    automation,
+    variableBlockSize
+};
+
+const char* getScenarioName (Scenario scenario)
+{
+    switch (scenario)
+    {
+        case Scenario::steady:            return "steady";
+        case Scenario::automation:        return "automation";
+        case Scenario::variableBlockSize: return "variable-block-size";
+    }
+
+    return "";
+}
+
+int getBlockLength (Scenario scenario, int blockIndex, int maxBlock)
+{
+    if (scenario != Scenario::variableBlockSize)
+        return maxBlock;
+
+    // What hosts actually do around loop points, offline bounces and split automation.
+    const int pattern[] = { maxBlock, 1, 13, maxBlock / 2, maxBlock - 1, 64, maxBlock };
+    const int length = pattern[blockIndex % static_cast<int> (std::size (pattern))];
+    return juce::jlimit (1, maxBlock, length);
+}
+
+template <typename FloatType>
+tribase::test::ProbeStats runScenario (ProcessorKind kind, double sampleRate, int blockSize, Scenario scenario)
+{
+    const auto precision = std::is_same_v<FloatType, double> ? "double" : "float";
+    const auto context = tribase::test::getProcessorId (kind) + " " + precision + " "
+                       + juce::String (sampleRate, 0) + " Hz, " + juce::String (blockSize) + " samples, "
+                       + getScenarioName (scenario);
+
+    auto processor = tribase::test::createProcessor (kind);
+    tribase::test::HeadlessSession<FloatType> session (*processor, kind, sampleRate, blockSize);
+
+    tribase::test::AudioThreadProbe::setContext (context.toRawUTF8());
+
+    tribase::test::ProbeStats total;
+
+    for (int block = 0; block < blocksPerScenario; ++block)
+    {
+        session.prepareNextBlock (scenario == Scenario::automation, getBlockLength (scenario, block, blockSize));
+
+        tribase::test::ScopedAudioThreadProbe probe;
+        session.process();
+        total += probe.finish();
+    }
+
+    tribase::test::AudioThreadProbe::setContext (nullptr);
+
+    std::cout << (total.getNumViolations() == 0 ? "PASS  " : "FAIL  ") << context
+              << " (" << (juce::int64) total.allocations << " allocations, "
+              << (juce::int64) total.deallocations << " frees, "
+              << (juce::int64) total.locks << " locks, "
+              << (juce::int64) total.syscalls << " syscalls, "
+              << (juce::int64) total.expected << " known)" << std::endl;
+
+    return total;
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+    const juce::ArgumentList args (argc, argv);
+
+    juce::Array<ProcessorKind> kinds;
+
+    if (const auto ids = args.getValueForOption ("--processors"); ids.isNotEmpty())
+    {
+        for (auto& id : juce::StringArray::fromTokens (ids, ",", {}))
+        {
+            ProcessorKind kind;
+            if (! tribase::test::parseProcessorId (id, kind))
+            {
+                std::cerr << "Unknown processor: " << id << "\n";
+                return 2;
+            }
+
+            kinds.add (kind);
+        }
+    }
+    else
+    {
+        for (auto kind : tribase::test::getAllProcessorKinds())
+            kinds.add (kind);
+    }
+
+    const auto precision = args.getValueForOption ("--precision").toLowerCase();
+    const bool runFloat = precision.isEmpty() || precision == "float";
+    const bool runDouble = precision.isEmpty() || precision == "double";
+
+    tribase::test::AudioThreadProbe::setReportCallSites (true);
+
+    juce::int64 failures = 0;
+
+    for (auto kind : kinds)
+    {
+        expectKnownViolations (kind);
+
+        for (const double sampleRate : { 44100.0, 96000.0 })
+        {
+            for (const int blockSize : { 64, 512 })
+            {
+                for (auto scenario : { Scenario::steady, Scenario::automation, Scenario::variableBlockSize })
+                {
+                    if (runFloat && runScenario<float> (kind, sampleRate, blockSize, scenario).getNumViolations() > 0)
+                        ++failures;
+
+                    if (runDouble && runScenario<double> (kind, sampleRate, blockSize, scenario).getNumViolations() > 0)
+                        ++failures;
+                }
+            }
+        }
+    }
+
+    if (failures > 0)
+    {
+        std::cout << failures << " scenario(s) are not real-time safe" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}